@@ -0,0 +1,692 @@
+#include "AudioEngine.h"
+#include "RtDiagnostics.h"
+#include "StreamBuffer.h"
+#include "TimeStretch.h"
+
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QAudioDevice>
+#include <QAudioSink>
+#include <QFile>
+#include <QIODevice>
+#include <QMediaDevices>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace {
+constexpr int kPollIntervalMs = 50;
+constexpr int kInitialBufferMs = 80;
+constexpr int kMinBufferMs = 40;
+constexpr int kMaxBufferMs = 640;
+// How long playback must run without an underrun before the buffer may shrink.
+constexpr qint64 kStableShrinkMs = 30000;
+// Played audio a live stream keeps before its chunks are freed.
+constexpr qint64 kLiveHistoryMs = 10000;
+// Played audio of a file that trimDecoded() leaves in place.
+constexpr qint64 kTrimHistoryMs = 30000;
+// Decoded audio ahead of playback at which a file's decoder is held; it
+// resumes once playback has used up half of it. trimDecoded() lowers the
+// window as far as kMinDecodeAheadMs for the rest of the track.
+constexpr qint64 kDecodeAheadMs = 60000;
+constexpr qint64 kMinDecodeAheadMs = 10000;
+constexpr int kHeldReadWaitMs = 250;
+
+qint64 steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+// Pull-mode device handed to QAudioSink; readData() is the render callback and
+// may run on the backend's audio thread. Everything it touches is either
+// immutable while the sink runs or an atomic, so it never allocates or locks.
+class PcmSource final : public QIODevice {
+public:
+    explicit PcmSource(const PcmBuffer &pcm)
+        : pcm_(pcm) {}
+
+    bool isSequential() const override { return true; }
+
+    qint64 cursor() const { return cursor_.load(std::memory_order_acquire); }
+    void setCursor(qint64 frame) {
+        cursor_.store(frame, std::memory_order_release);
+        ended_.store(false, std::memory_order_release);
+    }
+    bool endReached() const { return ended_.load(std::memory_order_acquire); }
+    quint64 underruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+    // Only while no sink pulls from this device.
+    void configureStretch(int sampleRate, int channels) {
+        stretch_.configure(sampleRate, channels);
+        stretching_ = false;
+    }
+    // A-B loop in frames; start < 0 or end < 0 disables it. The end is
+    // cleared first and published last, so the render thread never pairs an
+    // end with the start of an older loop for longer than one callback.
+    void setLoop(qint64 startFrame, qint64 endFrame) {
+        loopEnd_.store(-1, std::memory_order_release);
+        loopStart_.store(startFrame, std::memory_order_release);
+        loopEnd_.store(endFrame, std::memory_order_release);
+    }
+    double rate() const { return rate_.load(std::memory_order_relaxed); }
+    void setRate(double rate) { rate_.store(rate, std::memory_order_relaxed); }
+
+    // A gap between callbacks longer than the sink buffer means it ran dry.
+    void setBufferDurationNs(qint64 ns) { bufferNs_.store(ns, std::memory_order_relaxed); }
+    void resetTiming() { lastCallbackNs_.store(0, std::memory_order_relaxed); }
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override {
+        RtDiagnostics::AudioThreadScope audioThread;
+        const qint64 started = steadyNowNs();
+        const qint64 frameBytes = pcm_.channels() * qint64(sizeof(qint16));
+        if (frameBytes == 0) return 0;
+
+        const qint64 last = lastCallbackNs_.exchange(started, std::memory_order_relaxed);
+        const qint64 budget = bufferNs_.load(std::memory_order_relaxed);
+        if (last > 0 && budget > 0 && started - last > budget) {
+            underruns_.fetch_add(1, std::memory_order_relaxed);
+            RtDiagnostics::recordUnderrun();
+        }
+
+        const qint64 wanted = maxlen / frameBytes;
+        qint64 cursor = cursor_.load(std::memory_order_acquire);
+        const double rate = rate_.load(std::memory_order_relaxed);
+        const qint64 loopEnd = loopEnd_.load(std::memory_order_acquire);
+        const qint64 loopStart = loopEnd >= 0 ? loopStart_.load(std::memory_order_acquire) : -1;
+        // Only playback that reaches B from before it wraps; seeking past B
+        // leaves the loop.
+        const bool looping = loopStart >= 0 && loopStart < loopEnd && cursor < loopEnd;
+        const qint64 stopAt = looping ? loopEnd : std::numeric_limits<qint64>::max();
+        auto *out = reinterpret_cast<qint16 *>(data);
+        const int channels = pcm_.channels();
+        qint64 got = 0;
+        qint64 next = cursor;
+        if (rate == 1.0 || !stretch_.isConfigured()) {
+            stretching_ = false;
+            while (got < wanted) {
+                const qint64 count = pcm_.read(next, out + got * channels, std::min(wanted - got, stopAt - next));
+                got += count;
+                next += count;
+                if (next < stopAt) break;
+                next = loopStart;
+            }
+        } else {
+            // Anything but our own advance is a seek (or the switch from 1x).
+            if (!stretching_ || cursor != stretchCursor_) stretch_.reset(cursor);
+            stretching_ = true;
+            while (got < wanted) {
+                got += stretch_.process(pcm_, rate, out + got * channels, wanted - got, stopAt);
+                if (stretch_.position() < stopAt) break;
+                stretch_.jump(loopStart);
+            }
+            next = stretch_.position();
+            stretchCursor_ = next;
+        }
+        // A seek from the UI thread wins over our advance.
+        cursor_.compare_exchange_strong(cursor, next, std::memory_order_acq_rel);
+
+        qint64 bytes = got * frameBytes;
+        if (got < wanted) {
+            if (pcm_.isComplete() && next >= pcm_.availableFrames()) {
+                ended_.store(true, std::memory_order_release);
+            } else {
+                // The decoder has not reached the cursor yet (e.g. after a seek).
+                std::memset(data + bytes, 0, size_t((wanted - got) * frameBytes));
+                bytes = wanted * frameBytes;
+            }
+        }
+        RtDiagnostics::recordCallback(steadyNowNs() - started);
+        return bytes;
+    }
+
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    const PcmBuffer &pcm_;
+    TimeStretch stretch_;
+    // Render thread only, apart from configureStretch().
+    bool stretching_ = false;
+    qint64 stretchCursor_ = 0;
+    std::atomic<double> rate_{1.0};
+    std::atomic<qint64> loopStart_{-1};
+    std::atomic<qint64> loopEnd_{-1};
+    std::atomic<qint64> cursor_{0};
+    std::atomic<qint64> bufferNs_{0};
+    std::atomic<qint64> lastCallbackNs_{0};
+    std::atomic<quint64> underruns_{0};
+    std::atomic<bool> ended_{false};
+};
+
+// Local file handed to the decoder. QAudioDecoder cannot be paused, so reads
+// from a decoder thread block while the engine holds the input; the decoder
+// then stalls on its next read like it would on a slow disk. Reads on the
+// owner's thread never block.
+class DecoderInput final : public QFile {
+public:
+    DecoderInput(const QString &path, QObject *parent)
+        : QFile(path, parent) {}
+
+    void setHeld(bool held) {
+        {
+            QMutexLocker lock(&mutex_);
+            held_ = held;
+        }
+        if (!held) released_.wakeAll();
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override {
+        if (QThread::currentThread() != thread()) {
+            QMutexLocker lock(&mutex_);
+            while (held_) released_.wait(&mutex_, kHeldReadWaitMs);
+        }
+        return QFile::readData(data, maxlen);
+    }
+
+private:
+    QMutex mutex_;
+    QWaitCondition released_;
+    bool held_ = false;
+};
+
+AudioEngine::AudioEngine(QObject *parent)
+    : QObject(parent)
+    , pcmSource_(std::make_unique<PcmSource>(pcm_))
+    , bufferMs_(kInitialBufferMs) {
+    pcmSource_->open(QIODevice::ReadOnly);
+    clock_.start();
+
+    decoder_ = new QAudioDecoder(this);
+    QAudioFormat requested;
+    const QAudioFormat preferred = QMediaDevices::defaultAudioOutput().preferredFormat();
+    requested.setSampleRate(preferred.sampleRate() > 0 ? preferred.sampleRate() : 44100);
+    requested.setChannelCount(2);
+    requested.setSampleFormat(QAudioFormat::Int16);
+    decoder_->setAudioFormat(requested);
+
+    pollTimer_ = new QTimer(this);
+    pollTimer_->setInterval(kPollIntervalMs);
+
+    connect(decoder_, &QAudioDecoder::bufferReady, this, &AudioEngine::handleBufferReady);
+    connect(decoder_, &QAudioDecoder::finished, this, &AudioEngine::handleDecoderFinished);
+    connect(decoder_, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), this, &AudioEngine::handleDecoderError);
+    connect(decoder_, &QAudioDecoder::durationChanged, this, [this](qint64 duration) {
+        if (duration <= 0 || duration == durationMs_) return;
+        durationMs_ = duration;
+        emit durationChanged(durationMs_);
+    });
+    connect(pollTimer_, &QTimer::timeout, this, &AudioEngine::poll);
+}
+
+AudioEngine::~AudioEngine() {
+    // The sink must be gone before pcmSource_ is destroyed.
+    stopSink();
+    holdDecoder(false);
+    decoder_->stop();
+    closeStream();
+    closeInput();
+}
+
+void AudioEngine::setSource(const QUrl &source) {
+    stopSink();
+    holdDecoder(false);
+    decoder_->stop();
+    closeStream();
+    closeInput();
+    restartPending_ = false;
+    decodeError_.clear();
+    decodeAheadMs_ = kDecodeAheadMs;
+    pcm_.reset();
+    pcmSource_->setCursor(0);
+    pcmSource_->setLoop(-1, -1);
+    loopStartUs_ = -1;
+    loopEndUs_ = -1;
+    pendingPositionUs_ = -1;
+    format_ = QAudioFormat();
+    source_ = source;
+    playRequested_ = false;
+    lastPositionMs_ = -1;
+    if (durationMs_ != 0) { durationMs_ = 0; emit durationChanged(0); }
+    emit positionChanged(0);
+    setState(QMediaPlayer::StoppedState);
+
+    if (source_.isEmpty()) { setStatus(QMediaPlayer::NoMedia); return; }
+    setStatus(QMediaPlayer::LoadingMedia);
+    // A live stream cannot be played faster than it arrives.
+    pcmSource_->setRate(StreamBuffer::isStreamUrl(source_) ? 1.0 : playbackRate_);
+    if (StreamBuffer::isStreamUrl(source_)) {
+        stream_ = new StreamBuffer(source_, this);
+        connect(stream_, &StreamBuffer::streamTitleChanged, this, &AudioEngine::streamTitleChanged);
+        connect(stream_, &StreamBuffer::failed, this, [](const QString &message) {
+            qWarning("AudioEngine: %s", qPrintable(message));
+        });
+        stream_->start();
+        decoder_->setSourceDevice(stream_);
+    } else if (source_.isLocalFile()) {
+        input_ = new DecoderInput(source_.toLocalFile(), this);
+        // Unbuffered for the same reason as StreamBuffer: the decoder thread
+        // reads it.
+        if (input_->open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            decoder_->setSourceDevice(input_);
+        } else {
+            closeInput();
+            decoder_->setSource(source_); // reports the error
+        }
+    } else {
+        decoder_->setSource(source_);
+    }
+    decoder_->start();
+}
+
+bool AudioEngine::isLiveStream() const { return stream_ && stream_->isLive(); }
+
+void AudioEngine::closeStream() {
+    if (!stream_) return;
+    // The decoder no longer reads from it; close() also wakes a blocked read.
+    decoder_->setSourceDevice(nullptr);
+    stream_->close();
+    stream_->deleteLater();
+    stream_ = nullptr;
+}
+
+void AudioEngine::closeInput() {
+    if (!input_) return;
+    decoder_->setSourceDevice(nullptr);
+    input_->close();
+    input_->deleteLater();
+    input_ = nullptr;
+    decoderHeld_ = false;
+}
+
+void AudioEngine::holdDecoder(bool hold) {
+    if (!input_ || hold == decoderHeld_) return;
+    decoderHeld_ = hold;
+    input_->setHeld(hold);
+}
+
+void AudioEngine::paceDecoder() {
+    if (!input_ || !pcm_.isConfigured() || pcm_.isComplete()) return;
+    const qint64 ahead = pcm_.availableFrames() - playedFrame();
+    const qint64 limit = pcm_.msToFrames(decodeAheadMs_);
+    if (ahead >= limit) holdDecoder(true);
+    else if (ahead < limit / 2) holdDecoder(false);
+}
+
+void AudioEngine::play() {
+    if (source_.isEmpty() || status_ == QMediaPlayer::InvalidMedia || state_ == QMediaPlayer::PlayingState) return;
+    if (status_ == QMediaPlayer::EndOfMedia) {
+        if (!stream_ && pcm_.firstFrame() > 0) {
+            redecodeFrom(0, true);
+            setState(QMediaPlayer::PlayingState);
+            return;
+        }
+        pcmSource_->setCursor(0);
+        setStatus(pcm_.isComplete() ? QMediaPlayer::BufferedMedia : QMediaPlayer::LoadedMedia);
+    }
+    if (!pcm_.isConfigured()) {
+        playRequested_ = true;
+    } else if (sink_ && state_ == QMediaPlayer::PausedState) {
+        pcmSource_->resetTiming();
+        sink_->resume();
+    } else {
+        startSink();
+    }
+    setState(QMediaPlayer::PlayingState);
+}
+
+void AudioEngine::pause() {
+    if (state_ != QMediaPlayer::PlayingState) return;
+    playRequested_ = false;
+    if (sink_) sink_->suspend();
+    setState(QMediaPlayer::PausedState);
+}
+
+void AudioEngine::stop() {
+    if (state_ == QMediaPlayer::StoppedState) return;
+    stopSink();
+    playRequested_ = false;
+    if (!stream_ && pcm_.firstFrame() > 0) redecodeFrom(0, false);
+    else pcmSource_->setCursor(0);
+    paceDecoder();
+    lastPositionMs_ = 0;
+    emit positionChanged(0);
+    setState(QMediaPlayer::StoppedState);
+    if (status_ == QMediaPlayer::EndOfMedia) setStatus(QMediaPlayer::LoadedMedia);
+}
+
+void AudioEngine::setPosition(qint64 position) { setPositionUs(position * 1000); }
+
+void AudioEngine::setPositionUs(qint64 positionUs) {
+    if (isLiveStream()) return;
+    if (!pcm_.isConfigured()) {
+        // Applied once the format is known; playback waits for the decoder.
+        if (!source_.isEmpty()) pendingPositionUs_ = std::max<qint64>(0, positionUs);
+        return;
+    }
+    qint64 frame = pcm_.usToFrames(std::max<qint64>(0, positionUs));
+    if (pcm_.isComplete()) frame = std::min(frame, pcm_.availableFrames());
+    if (frame < pcm_.firstFrame()) {
+        redecodeFrom(positionUs, state_ == QMediaPlayer::PlayingState);
+        if (status_ == QMediaPlayer::EndOfMedia) setStatus(QMediaPlayer::LoadedMedia);
+        lastPositionMs_ = std::max<qint64>(0, positionUs) / 1000;
+        emit positionChanged(lastPositionMs_);
+        return;
+    }
+    // The render callback picks the new cursor up on its next pull; the sink
+    // stays open, so only the audio it already queued plays out first.
+    pcmSource_->setCursor(frame);
+    paceDecoder();
+    if (status_ == QMediaPlayer::EndOfMedia) setStatus(QMediaPlayer::BufferedMedia);
+    lastPositionMs_ = pcm_.framesToMs(frame);
+    emit positionChanged(lastPositionMs_);
+}
+
+qint64 AudioEngine::position() const { return pcm_.framesToMs(playedFrame()); }
+
+qint64 AudioEngine::positionUs() const { return pcm_.framesToUs(playedFrame()); }
+
+void AudioEngine::setLoop(qint64 startUs, qint64 endUs) {
+    if (startUs < 0 || endUs <= startUs) startUs = endUs = -1;
+    loopStartUs_ = startUs;
+    loopEndUs_ = endUs;
+    applyLoop();
+}
+
+void AudioEngine::applyLoop() {
+    // Without a format the loop is kept and applied once decoding starts.
+    if (!pcm_.isConfigured() || isLiveStream() || loopStartUs_ < 0) {
+        pcmSource_->setLoop(-1, -1);
+        return;
+    }
+    const qint64 startFrame = pcm_.usToFrames(loopStartUs_);
+    if (startFrame < pcm_.firstFrame()) {
+        // A was trimmed away; the loop is applied again once it is decoded.
+        redecodeFrom(positionUs(), state_ == QMediaPlayer::PlayingState);
+        return;
+    }
+    pcmSource_->setLoop(startFrame, pcm_.usToFrames(loopEndUs_));
+}
+
+void AudioEngine::trimDecoded(qint64 bytes) {
+    // Live streams free their own history in poll(); other streams cannot be
+    // read again.
+    if (stream_ || !pcm_.isConfigured()) return;
+    const qint64 excess = pcm_.memoryBytes() - bytes;
+    if (excess <= 0) return;
+    const qint64 chunkBytes = PcmBuffer::kChunkFrames * pcm_.channels() * qint64(sizeof(qint16));
+    qint64 frame = pcm_.firstFrame() + (excess + chunkBytes - 1) / chunkBytes * PcmBuffer::kChunkFrames;
+    frame = std::min(frame, playedFrame() - pcm_.msToFrames(kTrimHistoryMs));
+    if (loopStartUs_ >= 0) frame = std::min(frame, pcm_.usToFrames(loopStartUs_));
+    pcm_.releaseBefore(frame);
+    // What played audio cannot cover comes out of the audio decoded ahead.
+    const qint64 over = pcm_.memoryBytes() - bytes;
+    if (over <= 0 || !input_) return;
+    const qint64 frameBytes = pcm_.channels() * qint64(sizeof(qint16));
+    const qint64 aheadMs = pcm_.framesToMs(pcm_.availableFrames() - playedFrame() - over / frameBytes);
+    decodeAheadMs_ = std::clamp(aheadMs, kMinDecodeAheadMs, decodeAheadMs_);
+    paceDecoder();
+}
+
+void AudioEngine::redecodeFrom(qint64 positionUs, bool play) {
+    // Audio before positionUs was trimmed: decode the file again from the
+    // start. Loop, rate and duration carry over, and playback resumes once
+    // the decoder reaches positionUs (see handleBufferReady()).
+    stopSink();
+    holdDecoder(false);
+    decoder_->stop();
+    if (input_) input_->seek(0);
+    decodeError_.clear();
+    pcm_.reset();
+    pcmSource_->setCursor(0);
+    pendingPositionUs_ = std::max<qint64>(0, positionUs);
+    playRequested_ = play;
+    ++redecodes_;
+    decoder_->start();
+}
+
+void AudioEngine::setPlaybackRate(qreal rate) {
+    rate = std::clamp(rate, TimeStretch::kMinRate, TimeStretch::kMaxRate);
+    if (rate == playbackRate_) return;
+    playbackRate_ = rate;
+    if (!isLiveStream()) pcmSource_->setRate(playbackRate_);
+    emit playbackRateChanged(playbackRate_);
+}
+
+void AudioEngine::setVolume(float volume) {
+    volume_ = volume;
+    if (sink_) sink_->setVolume(volume_);
+}
+
+qint64 AudioEngine::latencyMs() const {
+    return sink_ ? format_.durationForBytes(static_cast<qint32>(sink_->bufferSize())) / 1000 : 0;
+}
+
+QString AudioEngine::report() const {
+    QStringList lines;
+    lines << "[Playback]";
+    if (sink_) {
+        lines << QString("Output latency: %1 ms (target %2 ms, range %3-%4 ms)")
+                     .arg(latencyMs()).arg(bufferMs_).arg(kMinBufferMs).arg(kMaxBufferMs);
+    } else {
+        lines << QString("Output latency: idle (target %1 ms)").arg(bufferMs_);
+    }
+    lines << QString("Buffer adjustments: %1 grown, %2 shrunk").arg(bufferGrowths_).arg(bufferShrinks_);
+    if (stream_) lines << stream_->report();
+    if (playbackRate_ != 1.0) lines << QString("Speed: %1x, pitch preserved").arg(playbackRate_);
+    if (!decodeError_.isEmpty()) lines << QString("Decoding stopped: %1").arg(decodeError_);
+    if (input_ && decoderHeld_) lines << QString("Decoder held %1 s ahead of playback").arg(decodeAheadMs_ / 1000);
+    if (redecodes_ > 0) lines << QString("Decoded again after memory trims: %1 times").arg(redecodes_);
+    if (loopStartUs_ >= 0) {
+        lines << QString("A-B loop: %1-%2 s").arg(loopStartUs_ / 1e6, 0, 'f', 6).arg(loopEndUs_ / 1e6, 0, 'f', 6);
+    }
+    if (pcm_.isConfigured()) {
+        lines << QString("Decoded: %1 s%2, %3 Hz x %4 ch, %5 MiB")
+                     .arg(pcm_.framesToMs(pcm_.availableFrames()) / 1000.0, 0, 'f', 1)
+                     .arg(pcm_.isComplete() ? " (complete)" : "")
+                     .arg(pcm_.sampleRate())
+                     .arg(pcm_.channels())
+                     .arg(pcm_.memoryBytes() / (1024.0 * 1024.0), 0, 'f', 1);
+    }
+    return lines.join('\n');
+}
+
+void AudioEngine::handleBufferReady() {
+    while (decodeError_.isEmpty() && decoder_->bufferAvailable()) {
+        const QAudioBuffer buffer = decoder_->read();
+        if (!buffer.isValid()) continue;
+        const QAudioFormat format = buffer.format();
+        if (!pcm_.isConfigured()) {
+            pcm_.reset(format.sampleRate(), format.channelCount());
+            pcmSource_->configureStretch(format.sampleRate(), format.channelCount());
+            applyLoop();
+            if (pendingPositionUs_ >= 0) pcmSource_->setCursor(pcm_.usToFrames(pendingPositionUs_));
+            pendingPositionUs_ = -1;
+            format_ = format;
+            format_.setSampleFormat(QAudioFormat::Int16);
+            setStatus(QMediaPlayer::LoadedMedia);
+            if (playRequested_) {
+                playRequested_ = false;
+                startSink();
+            }
+        }
+        if (format.sampleRate() != pcm_.sampleRate() || format.channelCount() != pcm_.channels()) continue;
+
+        const qint64 frames = buffer.frameCount();
+        if (format.sampleFormat() == QAudioFormat::Int16) {
+            appendPcm(buffer.constData<qint16>(), frames);
+            continue;
+        }
+        const qint64 samples = frames * format.channelCount();
+        const int bytesPerSample = format.bytesPerSample();
+        const char *data = buffer.constData<char>();
+        convertScratch_.resize(size_t(samples));
+        for (qint64 i = 0; i < samples; ++i) {
+            const float value = qBound(-1.0f, format.normalizedSampleValue(data + i * bytesPerSample), 1.0f);
+            convertScratch_[size_t(i)] = static_cast<qint16>(value * 32767.0f);
+        }
+        appendPcm(convertScratch_.data(), frames);
+    }
+    paceDecoder();
+}
+
+void AudioEngine::appendPcm(const qint16 *samples, qint64 frames) {
+    if (pcm_.append(samples, frames) || restartPending_) return;
+    if (!isLiveStream()) {
+        // Only when the decoder could not be held (it read on this thread)
+        // and nothing was trimmed. Stop rather than pass the audio decoded so
+        // far off as the whole file.
+        decodeError_ = QString("more than %1 s of decoded audio held")
+                           .arg(pcm_.framesToMs(PcmBuffer::kMaxChunks * PcmBuffer::kChunkFrames) / 1000);
+        qWarning("AudioEngine: %s: %s", qPrintable(source_.toDisplayString()), qPrintable(decodeError_));
+        holdDecoder(false);
+        decoder_->stop();
+        pcm_.markComplete();
+        if (status_ != QMediaPlayer::EndOfMedia) setStatus(QMediaPlayer::BufferedMedia);
+        return;
+    }
+    // The chunk ring of a live stream only fills if played audio cannot be
+    // released; start the stream over rather than go silent.
+    restartPending_ = true;
+    QTimer::singleShot(0, this, [this]() {
+        if (!restartPending_) return;
+        const bool playing = state_ == QMediaPlayer::PlayingState;
+        setSource(source_);
+        if (playing) play();
+    });
+}
+
+void AudioEngine::handleDecoderFinished() {
+    pcm_.markComplete();
+    if (!decodeError_.isEmpty()) return;
+    // The decoded frame count is exact; container durations are estimates.
+    const qint64 exact = pcm_.framesToMs(pcm_.availableFrames());
+    if (exact > 0 && exact != durationMs_) {
+        durationMs_ = exact;
+        emit durationChanged(durationMs_);
+    }
+    if (status_ != QMediaPlayer::EndOfMedia) setStatus(QMediaPlayer::BufferedMedia);
+}
+
+void AudioEngine::handleDecoderError() {
+    qWarning("AudioEngine: %s", qPrintable(decoder_->errorString()));
+    if (pcm_.isConfigured()) {
+        // Keep whatever was decoded playable.
+        handleDecoderFinished();
+        return;
+    }
+    playRequested_ = false;
+    setState(QMediaPlayer::StoppedState);
+    setStatus(QMediaPlayer::InvalidMedia);
+}
+
+void AudioEngine::poll() {
+    if (!sink_) return;
+
+    if (pcmSource_->endReached()
+        && (sink_->state() == QAudio::IdleState || sink_->bytesFree() >= sink_->bufferSize())) {
+        stopSink();
+        if (!decodeError_.isEmpty()) {
+            // Not the end of the file: stop here instead of moving on.
+            setState(QMediaPlayer::StoppedState);
+            setStatus(QMediaPlayer::InvalidMedia);
+            return;
+        }
+        lastPositionMs_ = durationMs_;
+        emit positionChanged(durationMs_);
+        setState(QMediaPlayer::StoppedState);
+        setStatus(QMediaPlayer::EndOfMedia);
+        return;
+    }
+
+    const qint64 now = clock_.elapsed();
+    const quint64 underruns = pcmSource_->underruns();
+    if (underruns != seenUnderruns_) {
+        seenUnderruns_ = underruns;
+        stableSinceMs_ = now;
+        if (bufferMs_ < kMaxBufferMs) {
+            bufferMs_ = std::min(bufferMs_ * 2, kMaxBufferMs);
+            ++bufferGrowths_;
+            restartSink();
+        }
+    } else if (bufferMs_ > kMinBufferMs && now - stableSinceMs_ >= kStableShrinkMs) {
+        // Applied on the next sink start (track change, stop/play) so a stable
+        // stream is not interrupted just to lower latency.
+        bufferMs_ = std::max(bufferMs_ / 2, kMinBufferMs);
+        ++bufferShrinks_;
+        stableSinceMs_ = now;
+    }
+
+    paceDecoder();
+    if (isLiveStream()) pcm_.releaseBefore(playedFrame() - pcm_.msToFrames(kLiveHistoryMs));
+    else pcm_.reclaim(); // chunks trimDecoded() retired during a render callback
+
+    const qint64 position = this->position();
+    if (position != lastPositionMs_) {
+        lastPositionMs_ = position;
+        emit positionChanged(position);
+    }
+}
+
+void AudioEngine::startSink() {
+    stopSink();
+    sink_ = new QAudioSink(QMediaDevices::defaultAudioOutput(), format_, this);
+    sink_->setBufferSize(format_.bytesForDuration(qint64(bufferMs_) * 1000));
+    sink_->setVolume(volume_);
+    pcmSource_->resetTiming();
+    sink_->start(pcmSource_.get());
+    pcmSource_->setBufferDurationNs(qint64(format_.durationForBytes(static_cast<qint32>(sink_->bufferSize()))) * 1000);
+    seenUnderruns_ = pcmSource_->underruns();
+    stableSinceMs_ = clock_.elapsed();
+    pollTimer_->start();
+}
+
+void AudioEngine::stopSink() {
+    pollTimer_->stop();
+    if (!sink_) return;
+    sink_->stop();
+    delete sink_;
+    sink_ = nullptr;
+}
+
+void AudioEngine::restartSink() {
+    // Audio still queued in the old sink is discarded, so resume from what was
+    // actually heard rather than from the read cursor.
+    const qint64 frame = playedFrame();
+    stopSink();
+    pcmSource_->setCursor(frame);
+    startSink();
+}
+
+qint64 AudioEngine::playedFrame() const {
+    qint64 frame = pcmSource_->cursor();
+    const qint64 frameBytes = pcm_.channels() * qint64(sizeof(qint16));
+    if (sink_ && frameBytes > 0) {
+        const qint64 queued = std::max<qint64>(0, sink_->bufferSize() - sink_->bytesFree());
+        // Queued output covers rate times as many input frames.
+        frame -= qint64(double(queued / frameBytes) * pcmSource_->rate());
+    }
+    return std::max<qint64>(0, frame);
+}
+
+void AudioEngine::setState(QMediaPlayer::PlaybackState state) {
+    if (state_ == state) return;
+    state_ = state;
+    emit playbackStateChanged(state_);
+}
+
+void AudioEngine::setStatus(QMediaPlayer::MediaStatus status) {
+    if (status_ == status) return;
+    status_ = status;
+    emit mediaStatusChanged(status_);
+}
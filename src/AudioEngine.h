@@ -0,0 +1,128 @@
+#pragma once
+
+#include "PcmBuffer.h"
+
+#include <QAudioFormat>
+#include <QElapsedTimer>
+#include <QMediaPlayer>
+#include <QObject>
+#include <QUrl>
+
+#include <memory>
+#include <vector>
+
+class QAudioDecoder;
+class QAudioSink;
+class QTimer;
+class DecoderInput;
+class PcmSource;
+class StreamBuffer;
+
+// Playback path that decodes into a PcmBuffer and feeds a QAudioSink in pull
+// mode. Unlike QAudioOutput, the sink buffer size is under our control: it is
+// doubled when the render callback detects an underrun and halved again after
+// a stable period. Mirrors the parts of the QMediaPlayer API the UI uses.
+// http(s) sources are read through a StreamBuffer; live streams cannot seek
+// and drop decoded audio once it has been played. Local files are decoded at
+// most a minute ahead of playback.
+class AudioEngine final : public QObject {
+    Q_OBJECT
+
+public:
+    explicit AudioEngine(QObject *parent = nullptr);
+    ~AudioEngine() override;
+
+    void setSource(const QUrl &source);
+    QUrl source() const { return source_; }
+    void play();
+    void pause();
+    void stop();
+    void setPosition(qint64 position);
+    qint64 position() const;
+    // Frame-accurate variants for cue points and loops.
+    void setPositionUs(qint64 positionUs);
+    qint64 positionUs() const;
+    // Repeats [startUs, endUs) without a gap once playback reaches endUs;
+    // an empty range clears it. setSource() clears the loop.
+    void setLoop(qint64 startUs, qint64 endUs);
+    bool hasLoop() const { return loopStartUs_ >= 0; }
+    qint64 duration() const { return durationMs_; }
+    bool isLiveStream() const;
+    // 0.5x-2x with the pitch kept; live streams always play at 1x.
+    qreal playbackRate() const { return playbackRate_; }
+    void setPlaybackRate(qreal rate);
+    void setVolume(float volume);
+
+    QMediaPlayer::PlaybackState playbackState() const { return state_; }
+    QMediaPlayer::MediaStatus mediaStatus() const { return status_; }
+    qint64 latencyMs() const;
+    qint64 memoryBytes() const { return pcm_.memoryBytes(); }
+    // Frees decoded audio of a file, oldest first, down to about bytes. Only
+    // audio well behind the play position and before an A-B loop goes; a
+    // later seek back into it decodes the file again. The rest of the excess
+    // shrinks how far ahead of playback the file is decoded.
+    void trimDecoded(qint64 bytes);
+    QString report() const;
+
+signals:
+    void positionChanged(qint64 position);
+    void durationChanged(qint64 duration);
+    void playbackRateChanged(qreal rate);
+    void playbackStateChanged(QMediaPlayer::PlaybackState state);
+    void mediaStatusChanged(QMediaPlayer::MediaStatus status);
+    void streamTitleChanged(const QString &title);
+
+private:
+    void handleBufferReady();
+    void handleDecoderFinished();
+    void handleDecoderError();
+    void appendPcm(const qint16 *samples, qint64 frames);
+    void closeStream();
+    void closeInput();
+    // Blocks (or lets go of) the decoder's reads from a local file.
+    void holdDecoder(bool hold);
+    void paceDecoder();
+    void redecodeFrom(qint64 positionUs, bool play);
+    void applyLoop();
+    void poll();
+    void startSink();
+    void stopSink();
+    void restartSink();
+    qint64 playedFrame() const;
+    void setState(QMediaPlayer::PlaybackState state);
+    void setStatus(QMediaPlayer::MediaStatus status);
+
+    QAudioDecoder *decoder_ = nullptr;
+    StreamBuffer *stream_ = nullptr;
+    DecoderInput *input_ = nullptr;
+    bool decoderHeld_ = false;
+    qint64 decodeAheadMs_ = 0;
+    QString decodeError_;
+    QAudioSink *sink_ = nullptr;
+    QTimer *pollTimer_ = nullptr;
+    QElapsedTimer clock_;
+    PcmBuffer pcm_;
+    std::unique_ptr<PcmSource> pcmSource_;
+    std::vector<qint16> convertScratch_;
+    QAudioFormat format_;
+    QUrl source_;
+    QMediaPlayer::PlaybackState state_ = QMediaPlayer::StoppedState;
+    QMediaPlayer::MediaStatus status_ = QMediaPlayer::NoMedia;
+    qint64 durationMs_ = 0;
+    qint64 lastPositionMs_ = -1;
+    float volume_ = 1.0f;
+    qreal playbackRate_ = 1.0;
+    qint64 loopStartUs_ = -1;
+    qint64 loopEndUs_ = -1;
+    qint64 pendingPositionUs_ = -1;
+    bool playRequested_ = false;
+    bool restartPending_ = false;
+    int redecodes_ = 0;
+
+    // Adaptive buffering state.
+    int bufferMs_ = 0;
+    quint64 seenUnderruns_ = 0;
+    qint64 stableSinceMs_ = 0;
+    int bufferGrowths_ = 0;
+    int bufferShrinks_ = 0;
+};
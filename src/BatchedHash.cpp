@@ -0,0 +1,257 @@
+#include "BatchedHash.h"
+#include "ContentHash.h"
+
+#include <QFile>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define MUSICPLAYER_HAS_IO_URING 1
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <vector>
+#endif
+
+#ifdef MUSICPLAYER_HAS_IO_URING
+namespace {
+constexpr unsigned kRingEntries = 256;
+// Files with buffers in flight; each holds one open or up to two reads.
+constexpr int kFilesInFlight = kRingEntries / 2;
+constexpr qint64 kEdgeBufferBytes = 2 * kContentHashEdgeBytes;
+
+enum Stage : quint64 { kOpen = 0, kHeadRead = 1, kTailRead = 2 };
+
+int ringSetup(unsigned entries, io_uring_params *params) { return int(syscall(__NR_io_uring_setup, entries, params)); }
+
+int ringEnter(int fd, unsigned submit, unsigned wait) {
+    return int(syscall(__NR_io_uring_enter, fd, submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+}
+
+// Submission and completion rings of one io_uring, mapped by init().
+class Ring final {
+public:
+    ~Ring() {
+        if (sqes_) munmap(sqes_, sqesBytes_);
+        if (cqRing_ && cqRing_ != sqRing_) munmap(cqRing_, cqBytes_);
+        if (sqRing_) munmap(sqRing_, sqBytes_);
+        if (fd_ >= 0) close(fd_);
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd_ = ringSetup(entries, &params);
+        if (fd_ < 0) return false;
+        sqBytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqBytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) sqBytes_ = cqBytes_ = std::max(sqBytes_, cqBytes_);
+        sqRing_ = map(sqBytes_, IORING_OFF_SQ_RING);
+        if (!sqRing_) return false;
+        cqRing_ = single ? sqRing_ : map(cqBytes_, IORING_OFF_CQ_RING);
+        if (!cqRing_) return false;
+        sqesBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe *>(map(sqesBytes_, IORING_OFF_SQES));
+        if (!sqes_) return false;
+
+        char *sq = static_cast<char *>(sqRing_);
+        sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        char *cq = static_cast<char *>(cqRing_);
+        cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return supports(IORING_OP_OPENAT) && supports(IORING_OP_READ);
+    }
+
+    // The caller keeps the number of requests in flight within the ring size.
+    io_uring_sqe *next() {
+        const unsigned index = sqLocalTail_ & sqMask_;
+        io_uring_sqe *sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray_[index] = index;
+        ++sqLocalTail_;
+        ++unsubmitted_;
+        return sqe;
+    }
+
+    // Submits what next() queued and waits for at least one completion. The
+    // kernel may take fewer entries than offered; the rest are offered again
+    // until all are in.
+    bool submitAndWait() {
+        __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+        do {
+            const int submitted = ringEnter(fd_, unsubmitted_, 1);
+            if (submitted < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            // Nothing taken and no error: the entries would never go in.
+            if (submitted == 0 && unsubmitted_ > 0) return false;
+            unsubmitted_ -= unsigned(submitted);
+        } while (unsubmitted_ > 0);
+        return true;
+    }
+
+    template <typename Visit>
+    void drain(Visit visit) {
+        unsigned head = *cqHead_;
+        const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = cqes_[head & cqMask_];
+            visit(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    void *map(size_t bytes, off_t offset) {
+        void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    bool supports(int opcode) const {
+        const size_t bytes = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        std::unique_ptr<char[]> storage(new char[bytes]());
+        auto *probe = reinterpret_cast<io_uring_probe *>(storage.get());
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, 256) < 0) return false;
+        return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    int fd_ = -1;
+    void *sqRing_ = nullptr;
+    void *cqRing_ = nullptr;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sqBytes_ = 0;
+    size_t cqBytes_ = 0;
+    size_t sqesBytes_ = 0;
+    unsigned *sqTail_ = nullptr;
+    unsigned *sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqLocalTail_ = 0;
+    unsigned unsubmitted_ = 0;
+    unsigned *cqHead_ = nullptr;
+    unsigned *cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+};
+
+// One file being hashed, using one of the kFilesInFlight edge buffers.
+struct Slot {
+    int file = -1;
+    int fd = -1;
+    int pendingReads = 0;
+    qint64 expected = 0;
+    bool failed = false;
+    std::unique_ptr<char[]> buffer{new char[kEdgeBufferBytes]};
+};
+} // namespace
+#endif
+
+bool batchedContentHashes(const QStringList &paths, const QVector<qint64> &sizes, QVector<quint64> *hashes) {
+#ifdef MUSICPLAYER_HAS_IO_URING
+    Ring ring;
+    if (!ring.init(kRingEntries)) return false;
+
+    const int count = int(paths.size());
+    QVector<QByteArray> encoded(count);
+    QVector<quint64> results(count, 0);
+    std::vector<Slot> slots(size_t(std::min(count, kFilesInFlight)));
+    std::vector<int> freeSlots;
+    for (int i = int(slots.size()) - 1; i >= 0; --i) freeSlots.push_back(i);
+    int nextFile = 0;
+    int active = 0;
+
+    const auto userData = [](int slot, Stage stage) { return (quint64(slot) << 2) | stage; };
+    const auto queueRead = [&](int slot, qint64 offset, qint64 length, char *into, Stage stage) {
+        io_uring_sqe *sqe = ring.next();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = slots[size_t(slot)].fd;
+        sqe->addr = quint64(reinterpret_cast<quintptr>(into));
+        sqe->len = unsigned(length);
+        sqe->off = quint64(offset);
+        sqe->user_data = userData(slot, stage);
+        ++slots[size_t(slot)].pendingReads;
+    };
+    const auto finish = [&](Slot &slot) {
+        if (slot.fd >= 0) close(slot.fd);
+        if (!slot.failed) results[slot.file] = partialContentHash(slot.buffer.get(), slot.expected, sizes[slot.file]);
+        slot.fd = -1;
+        slot.file = -1;
+        --active;
+    };
+
+    while (nextFile < count || active > 0) {
+        while (nextFile < count && !freeSlots.empty()) {
+            const int index = freeSlots.back();
+            freeSlots.pop_back();
+            Slot &slot = slots[size_t(index)];
+            slot.file = nextFile;
+            slot.failed = false;
+            slot.pendingReads = 0;
+            encoded[nextFile] = QFile::encodeName(paths[nextFile]);
+            io_uring_sqe *sqe = ring.next();
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = quint64(reinterpret_cast<quintptr>(encoded[nextFile].constData()));
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data = userData(index, kOpen);
+            ++nextFile;
+            ++active;
+        }
+        if (!ring.submitAndWait()) {
+            // Requests may still reference our buffers; only leaking them is safe.
+            for (Slot &slot : slots) (void)slot.buffer.release();
+            return false;
+        }
+        ring.drain([&](quint64 data, int result) {
+            const int index = int(data >> 2);
+            Slot &slot = slots[size_t(index)];
+            const qint64 size = sizes[slot.file];
+            switch (Stage(data & 3)) {
+            case kOpen:
+                if (result < 0) {
+                    slot.failed = true;
+                    break;
+                }
+                slot.fd = result;
+                if (size <= 2 * kContentHashEdgeBytes) {
+                    slot.expected = size;
+                    queueRead(index, 0, size, slot.buffer.get(), kHeadRead);
+                } else {
+                    slot.expected = kEdgeBufferBytes;
+                    queueRead(index, 0, kContentHashEdgeBytes, slot.buffer.get(), kHeadRead);
+                    queueRead(index, size - kContentHashEdgeBytes, kContentHashEdgeBytes,
+                              slot.buffer.get() + kContentHashEdgeBytes, kTailRead);
+                }
+                return;
+            case kHeadRead:
+            case kTailRead: {
+                const qint64 wanted = size <= 2 * kContentHashEdgeBytes ? size : kContentHashEdgeBytes;
+                // A short read means the file changed under us; the caller retries it.
+                if (result != wanted) slot.failed = true;
+                if (--slot.pendingReads > 0) return;
+                break;
+            }
+            }
+            finish(slot);
+            freeSlots.push_back(index);
+        });
+    }
+    *hashes = results;
+    return true;
+#else
+    Q_UNUSED(paths);
+    Q_UNUSED(sizes);
+    Q_UNUSED(hashes);
+    return false;
+#endif
+}
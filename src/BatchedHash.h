@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QStringList>
+#include <QVector>
+
+// partialContentHash() for many files at once. On Linux the opens and edge
+// reads go through one io_uring with hundreds of requests in flight, which
+// hides per-request latency on network storage far better than a few
+// blocking threads can. Only the raw system calls are used, no liburing.
+//
+// Returns false without touching hashes when io_uring cannot be used (other
+// platforms, kernels older than 5.6, sandboxes that block it); callers then
+// hash file by file. Files that fail to read get 0.
+bool batchedContentHashes(const QStringList &paths, const QVector<qint64> &sizes, QVector<quint64> *hashes);
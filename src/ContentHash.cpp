@@ -0,0 +1,92 @@
+#include "ContentHash.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QtEndian>
+
+namespace {
+constexpr quint64 kPrime1 = 11400714785074694791ULL;
+constexpr quint64 kPrime2 = 14029467366897019727ULL;
+constexpr quint64 kPrime3 = 1609587929392839161ULL;
+constexpr quint64 kPrime4 = 9650029242287828579ULL;
+constexpr quint64 kPrime5 = 2870177450012600261ULL;
+
+inline quint64 rotl(quint64 value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+inline quint64 read64(const uchar *p) { return qFromLittleEndian<quint64>(p); }
+inline quint32 read32(const uchar *p) { return qFromLittleEndian<quint32>(p); }
+
+inline quint64 xxRound(quint64 acc, quint64 input) {
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+inline quint64 mergeRound(quint64 acc, quint64 value) {
+    acc ^= xxRound(0, value);
+    return acc * kPrime1 + kPrime4;
+}
+} // namespace
+
+quint64 xxHash64(const void *data, qsizetype length, quint64 seed) {
+    const uchar *p = static_cast<const uchar *>(data);
+    const uchar *end = p + length;
+    quint64 hash;
+
+    if (length >= 32) {
+        const uchar *limit = end - 32;
+        quint64 v1 = seed + kPrime1 + kPrime2;
+        quint64 v2 = seed + kPrime2;
+        quint64 v3 = seed;
+        quint64 v4 = seed - kPrime1;
+        do {
+            v1 = xxRound(v1, read64(p));
+            v2 = xxRound(v2, read64(p + 8));
+            v3 = xxRound(v3, read64(p + 16));
+            v4 = xxRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    } else {
+        hash = seed + kPrime5;
+    }
+
+    hash += quint64(length);
+    for (; p + 8 <= end; p += 8) hash = rotl(hash ^ xxRound(0, read64(p)), 27) * kPrime1 + kPrime4;
+    if (p + 4 <= end) {
+        hash = rotl(hash ^ (quint64(read32(p)) * kPrime1), 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p) hash = rotl(hash ^ (*p * kPrime5), 11) * kPrime1;
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+quint64 partialContentHash(const QString &filePath, qint64 size) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+    QByteArray bytes;
+    if (size <= 2 * kContentHashEdgeBytes) {
+        bytes = file.readAll();
+    } else {
+        bytes = file.read(kContentHashEdgeBytes);
+        if (!file.seek(size - kContentHashEdgeBytes)) return 0;
+        bytes += file.read(kContentHashEdgeBytes);
+    }
+    return partialContentHash(bytes.constData(), bytes.size(), size);
+}
+
+quint64 partialContentHash(const char *edges, qsizetype length, qint64 size) {
+    if (length <= 0) return 0;
+    // Zero is reserved for "no hash".
+    const quint64 hash = xxHash64(edges, length, quint64(size));
+    return hash ? hash : 1;
+}
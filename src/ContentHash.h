@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+// XXH64 of a memory block.
+quint64 xxHash64(const void *data, qsizetype length, quint64 seed = 0);
+
+constexpr qint64 kContentHashEdgeBytes = 64 * 1024;
+
+// Identity hash of an audio file that survives moves and renames: XXH64 of the
+// first and last 64 KiB, seeded with the file size. Returns 0 if the file
+// cannot be read.
+quint64 partialContentHash(const QString &filePath, qint64 size);
+// The same hash over edges already read: the whole file when it is at most
+// two edge chunks long, else its first and last chunk back to back.
+quint64 partialContentHash(const char *edges, qsizetype length, qint64 size);
@@ -0,0 +1,136 @@
+#include "CueSheet.h"
+#include "LibraryScanner.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringDecoder>
+
+#include <algorithm>
+
+namespace {
+constexpr qint64 kMaxSheetBytes = 1024 * 1024;
+constexpr qint64 kCueFramesPerSecond = 75;
+
+// Splits a sheet line into words; quoted words keep their spaces.
+QStringList cueWords(const QString &line) {
+    QStringList words;
+    int i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && line[i].isSpace()) ++i;
+        if (i >= line.size()) break;
+        if (line[i] == '"') {
+            const int close = line.indexOf('"', i + 1);
+            const int end = close < 0 ? int(line.size()) : close;
+            words.append(line.mid(i + 1, end - i - 1));
+            i = end + 1;
+        } else {
+            int end = i;
+            while (end < line.size() && !line[end].isSpace()) ++end;
+            words.append(line.mid(i, end - i));
+            i = end;
+        }
+    }
+    return words;
+}
+
+// "mm:ss:ff" to microseconds, rounded; -1 when malformed.
+qint64 cueTimeUs(const QString &text) {
+    const QStringList parts = text.split(':');
+    if (parts.size() != 3) return -1;
+    bool ok[3] = {};
+    const qint64 minutes = parts[0].toLongLong(&ok[0]);
+    const qint64 seconds = parts[1].toLongLong(&ok[1]);
+    const qint64 frames = parts[2].toLongLong(&ok[2]);
+    if (!ok[0] || !ok[1] || !ok[2] || seconds >= 60 || frames >= kCueFramesPerSecond) return -1;
+    const qint64 totalFrames = (minutes * 60 + seconds) * kCueFramesPerSecond + frames;
+    return (totalFrames * 1000000 + kCueFramesPerSecond / 2) / kCueFramesPerSecond;
+}
+
+QString resolveAudioFile(const QDir &dir, const QString &name) {
+    const QString direct = dir.filePath(name);
+    if (QFileInfo::exists(direct)) return direct;
+    const QString baseName = QFileInfo(name).completeBaseName();
+    const QStringList candidates = dir.entryList({baseName + ".*"}, QDir::Files);
+    for (const QString &candidate : candidates) {
+        if (isAudioFile(candidate)) return dir.filePath(candidate);
+    }
+    return {};
+}
+} // namespace
+
+const CueTrack *CueSheet::track(int number) const {
+    for (const CueTrack &entry : tracks) {
+        if (entry.number == number) return &entry;
+    }
+    return nullptr;
+}
+
+bool readCueSheet(const QString &cuePath, CueSheet *sheet) {
+    QFile file(cuePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() > kMaxSheetBytes) return false;
+    const QByteArray data = file.readAll();
+    // Sheets from older rippers are in the local code page (often Shift_JIS).
+    QStringDecoder utf8(QStringDecoder::Utf8, QStringDecoder::Flag::Stateless);
+    QString text = utf8(data);
+    if (utf8.hasError()) text = QString::fromLocal8Bit(data);
+    if (text.startsWith(QChar(0xFEFF))) text.remove(0, 1);
+
+    *sheet = CueSheet();
+    const QDir dir = QFileInfo(cuePath).absoluteDir();
+    QString fileName;
+    int files = 0;
+    CueTrack *current = nullptr;
+    bool inAudioTrack = false;
+    const QStringList lines = text.split('\n');
+    for (const QString &line : lines) {
+        const QStringList words = cueWords(line);
+        if (words.isEmpty()) continue;
+        const QString command = words[0].toUpper();
+        if (command == "FILE" && words.size() >= 2) {
+            if (++files > 1) return false;
+            fileName = words[1];
+        } else if (command == "TRACK" && words.size() >= 3) {
+            inAudioTrack = words[2].toUpper() == "AUDIO";
+            current = nullptr;
+            if (!inAudioTrack) continue;
+            CueTrack entry;
+            entry.number = words[1].toInt();
+            entry.startUs = -1;
+            sheet->tracks.append(entry);
+            current = &sheet->tracks.last();
+        } else if (command == "TITLE" && words.size() >= 2) {
+            (current ? current->title : sheet->title) = words[1];
+        } else if (command == "PERFORMER" && words.size() >= 2) {
+            (current ? current->performer : sheet->performer) = words[1];
+        } else if (command == "INDEX" && words.size() >= 3 && current && words[1].toInt() == 1) {
+            current->startUs = cueTimeUs(words[2]);
+        }
+    }
+    if (fileName.isEmpty()) return false;
+    sheet->audioPath = resolveAudioFile(dir, fileName);
+    if (sheet->audioPath.isEmpty()) return false;
+
+    sheet->tracks.erase(std::remove_if(sheet->tracks.begin(), sheet->tracks.end(),
+                                       [](const CueTrack &entry) { return entry.startUs < 0 || entry.number <= 0; }),
+                        sheet->tracks.end());
+    std::sort(sheet->tracks.begin(), sheet->tracks.end(),
+              [](const CueTrack &a, const CueTrack &b) { return a.startUs < b.startUs; });
+    for (int i = 0; i + 1 < sheet->tracks.size(); ++i) sheet->tracks[i].endUs = sheet->tracks[i + 1].startUs;
+    return !sheet->tracks.isEmpty();
+}
+
+QString cueTrackPath(const QString &cuePath, int number) { return cuePath + '#' + QString::number(number); }
+
+bool splitCueTrackPath(const QString &path, QString *cuePath, int *number) {
+    const int hash = path.lastIndexOf('#');
+    if (hash < 4 || !path.left(hash).endsWith(".cue", Qt::CaseInsensitive)) return false;
+    bool ok = false;
+    const int value = path.mid(hash + 1).toInt(&ok);
+    if (!ok || value <= 0) return false;
+    if (cuePath) *cuePath = path.left(hash);
+    if (number) *number = value;
+    return true;
+}
+
+bool isCueTrackPath(const QString &path) { return splitCueTrackPath(path, nullptr, nullptr); }
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+// One track of a CUE sheet. Positions are microseconds into the audio file;
+// CD frames (1/75 s) convert to whole samples at 44.1 kHz.
+struct CueTrack {
+    int number = 0;
+    QString title;
+    QString performer;
+    qint64 startUs = 0; // INDEX 01
+    qint64 endUs = -1;  // next track's INDEX 01, -1 for the last track
+};
+
+struct CueSheet {
+    QString audioPath;
+    QString title;
+    QString performer;
+    QVector<CueTrack> tracks; // ascending
+
+    const CueTrack *track(int number) const;
+};
+
+// Reads a sheet that splits one audio file next to it into tracks. Sheets with
+// several FILE entries describe albums that are already split and are
+// rejected, as are sheets whose audio file is missing. A FILE naming another
+// extension (album.wav for album.flac) falls back to a sibling audio file with
+// the same base name.
+bool readCueSheet(const QString &cuePath, CueSheet *sheet);
+
+// Library path of a CUE track: "<sheet path>#<track number>". It names the
+// sheet rather than the audio file so it is self-describing wherever paths
+// travel (history, cache, shared library).
+QString cueTrackPath(const QString &cuePath, int number);
+bool splitCueTrackPath(const QString &path, QString *cuePath, int *number);
+bool isCueTrackPath(const QString &path);
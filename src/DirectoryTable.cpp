@@ -0,0 +1,198 @@
+#include "DirectoryTable.h"
+
+#include <QDir>
+#include <QPair>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+QString parentPath(const QString &path) {
+    const int slash = path.lastIndexOf('/');
+    return slash > 0 ? path.left(slash) : QString();
+}
+} // namespace
+
+template <typename Visit>
+void DirectoryTable::visitSubtree(int id, Visit visit) const {
+    QVector<QPair<int, QString>> stack{{id, path(id)}};
+    while (!stack.isEmpty()) {
+        const auto [dirId, dirPath] = stack.takeLast();
+        visit(dirId, dirPath);
+        for (int childId : dirs_[dirId].childIds) stack.append({childId, dirPath + '/' + dirs_[childId].name});
+    }
+}
+
+int DirectoryTable::addRoot(const QString &path) {
+    const QString rootPath = QDir::cleanPath(path);
+    const int existing = find(rootPath);
+    if (existing >= 0) {
+        // The folder of loose files turns into a root when it is scanned.
+        if (dirs_[existing].parentId < 0) dirs_[existing].libraryRoot = true;
+        return existing;
+    }
+    const int id = create(rootPath, -1, rootPath);
+    dirs_[id].libraryRoot = true;
+
+    // Former roots below the new one become ordinary folders of it.
+    const QString prefix = rootPath + '/';
+    QVector<int> kept;
+    QVector<int> nested;
+    for (int rootId : std::as_const(roots_)) {
+        if (rootId != id && dirs_[rootId].name.startsWith(prefix)) nested.append(rootId);
+        else kept.append(rootId);
+    }
+    if (nested.isEmpty()) return id;
+    roots_ = kept;
+    for (int row = 0; row < roots_.size(); ++row) dirs_[roots_[row]].row = row;
+    for (int nestedId : std::as_const(nested)) {
+        const QString fullPath = dirs_[nestedId].name;
+        const int parentId = intern(parentPath(fullPath));
+        Directory &dir = dirs_[nestedId];
+        dir.name = fullPath.mid(fullPath.lastIndexOf('/') + 1);
+        dir.parentId = parentId;
+        dir.libraryRoot = false;
+        dir.row = int(dirs_[parentId].childIds.size());
+        dirs_[parentId].childIds.append(nestedId);
+        addToTotals(parentId, dir.totalTracks);
+    }
+    changes_.restructured = true;
+    return id;
+}
+
+int DirectoryTable::addTrack(int trackId, const QString &filePath) {
+    const int id = intern(parentPath(filePath));
+    QVector<int> &tracks = dirs_[id].trackIds;
+    tracks.insert(std::lower_bound(tracks.begin(), tracks.end(), trackId), trackId);
+    addToTotals(id, 1);
+    return id;
+}
+
+void DirectoryTable::moveTrack(int trackId, const QString &fromPath, const QString &toPath) {
+    removeTrack(trackId, fromPath);
+    addTrack(trackId, toPath);
+}
+
+void DirectoryTable::removeTrack(int trackId, const QString &filePath) {
+    const int id = find(parentPath(filePath));
+    if (id < 0) return;
+    QVector<int> &tracks = dirs_[id].trackIds;
+    const auto it = std::lower_bound(tracks.begin(), tracks.end(), trackId);
+    if (it == tracks.end() || *it != trackId) return;
+    tracks.erase(it);
+    addToTotals(id, -1);
+}
+
+QVector<int> DirectoryTable::removeSubtree(int id) {
+    if (id < 0 || id >= dirs_.size() || dirs_[id].removed) return {};
+    const QVector<int> tracks = subtreeTrackIds(id);
+    const int parentId = dirs_[id].parentId;
+    QVector<int> &siblings = parentId < 0 ? roots_ : dirs_[parentId].childIds;
+    siblings.remove(dirs_[id].row);
+    for (int row = dirs_[id].row; row < siblings.size(); ++row) dirs_[siblings[row]].row = row;
+    if (parentId >= 0) addToTotals(parentId, -dirs_[id].totalTracks);
+
+    QVector<int> subtree;
+    visitSubtree(id, [&](int dirId, const QString &dirPath) {
+        ids_.remove(dirPath);
+        subtree.append(dirId);
+    });
+    for (int dirId : std::as_const(subtree)) {
+        Directory &dir = dirs_[dirId];
+        dir.removed = true;
+        dir.childIds.clear();
+        dir.trackIds.clear();
+        dir.totalTracks = 0;
+        --liveCount_;
+    }
+    changes_.restructured = true;
+    return tracks;
+}
+
+bool DirectoryTable::relocateRoot(int id, const QString &newPath) {
+    if (id < 0 || id >= dirs_.size() || dirs_[id].removed || dirs_[id].parentId >= 0) return false;
+    const QString newRoot = QDir::cleanPath(newPath);
+    if (find(newRoot) >= 0) return false;
+    for (int rootId : std::as_const(roots_)) {
+        const QString &rootPath = dirs_[rootId].name;
+        if (rootId != id && (newRoot.startsWith(rootPath + '/') || rootPath.startsWith(newRoot + '/'))) return false;
+    }
+    const QString oldRoot = dirs_[id].name;
+    QVector<QPair<int, QString>> renamed;
+    visitSubtree(id, [&](int dirId, const QString &dirPath) {
+        ids_.remove(dirPath);
+        renamed.append({dirId, newRoot + dirPath.mid(oldRoot.size())});
+    });
+    for (const auto &entry : std::as_const(renamed)) ids_.insert(entry.second, entry.first);
+    dirs_[id].name = newRoot;
+    changes_.restructured = true;
+    return true;
+}
+
+QStringList DirectoryTable::rootPaths() const {
+    QStringList paths;
+    for (int rootId : roots_) {
+        if (dirs_[rootId].libraryRoot) paths.append(dirs_[rootId].name);
+    }
+    return paths;
+}
+
+QString DirectoryTable::path(int id) const {
+    QStringList parts;
+    for (; id >= 0; id = dirs_[id].parentId) parts.prepend(dirs_[id].name);
+    return parts.join('/');
+}
+
+QVector<int> DirectoryTable::subtreeTrackIds(int id) const {
+    QVector<int> ids;
+    if (id < 0 || id >= dirs_.size()) return ids;
+    ids.reserve(dirs_[id].totalTracks);
+    QVector<int> stack{id};
+    while (!stack.isEmpty()) {
+        const Directory &dir = dirs_[stack.takeLast()];
+        ids += dir.trackIds;
+        stack += dir.childIds;
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+DirectoryTable::Changes DirectoryTable::takeChanges() { return std::exchange(changes_, Changes()); }
+
+int DirectoryTable::intern(const QString &dirPath) {
+    const int existing = find(dirPath);
+    if (existing >= 0) return existing;
+    // Folders below a known one are created down from it. Others lie outside
+    // every root (none are added that way by the scanner) and become
+    // top-level entries under their full path.
+    const QString parent = parentPath(dirPath);
+    bool known = false;
+    for (QString ancestor = parent; !known && !ancestor.isEmpty(); ancestor = parentPath(ancestor)) {
+        known = ids_.contains(ancestor);
+    }
+    if (!known) return create(dirPath, -1, dirPath);
+    const int parentId = intern(parent);
+    return create(dirPath.mid(parent.size() + 1), parentId, dirPath);
+}
+
+int DirectoryTable::create(const QString &name, int parentId, const QString &dirPath) {
+    const int id = int(dirs_.size());
+    Directory dir;
+    dir.name = name;
+    dir.parentId = parentId;
+    QVector<int> &siblings = parentId < 0 ? roots_ : dirs_[parentId].childIds;
+    dir.row = int(siblings.size());
+    siblings.append(id);
+    dirs_.append(dir);
+    ids_.insert(dirPath, id);
+    ++liveCount_;
+    changes_.created.append(id);
+    return id;
+}
+
+void DirectoryTable::addToTotals(int id, int delta) {
+    for (; id >= 0; id = dirs_[id].parentId) {
+        dirs_[id].totalTracks += delta;
+        changes_.touched.insert(id);
+    }
+}
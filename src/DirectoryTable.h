@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Interned folder hierarchy of the library.
+//
+// Every folder between a library root and a track gets a dense ID once; roots
+// keep their full path as name, other folders only their last segment. Each
+// folder lists its direct tracks and keeps the track count of its whole
+// subtree up to date as tracks come and go, so the folder tree never has to
+// walk the disk or the track list.
+class DirectoryTable final {
+public:
+    struct Directory {
+        QString name;
+        int parentId = -1;
+        int row = 0; // position among the parent's children (or the roots)
+        QVector<int> childIds;
+        QVector<int> trackIds; // ascending
+        int totalTracks = 0;
+        bool libraryRoot = false; // added with addRoot(), see rootPaths()
+        bool removed = false; // IDs are never reused
+    };
+
+    // What changed since the last takeChanges(): folders created (children
+    // are always appended), folders whose totals changed, and whether folders
+    // were re-parented.
+    struct Changes {
+        QVector<int> created;
+        QSet<int> touched;
+        bool restructured = false;
+    };
+
+    // Registers a library root. A path inside an existing root is returned as
+    // is; existing roots inside path are re-parented below it.
+    int addRoot(const QString &path);
+    // Files trackId under the folder of filePath; returns the folder ID. A
+    // folder outside every root (a file opened on its own) becomes a
+    // top-level entry that is not a library root.
+    int addTrack(int trackId, const QString &filePath);
+    void moveTrack(int trackId, const QString &fromPath, const QString &toPath);
+    void removeTrack(int trackId, const QString &filePath);
+    // Drops a folder with all subfolders and returns their tracks, ascending.
+    // Costs O(folders and tracks removed).
+    QVector<int> removeSubtree(int id);
+    // Moves a root to newPath, rewriting only the paths of its own subtree.
+    // Fails if newPath is already part of the library or contains a root.
+    bool relocateRoot(int id, const QString &newPath);
+
+    int find(const QString &dirPath) const { return ids_.value(dirPath, -1); }
+    QString path(int id) const;
+    const Directory &directory(int id) const { return dirs_[id]; }
+    // Top-level entries: library roots and the folders of loose files.
+    const QVector<int> &rootIds() const { return roots_; }
+    // Library roots only: what is scanned again and shared.
+    QStringList rootPaths() const;
+    int size() const { return int(dirs_.size()); }
+    int liveCount() const { return liveCount_; }
+    // Tracks of the folder and all its subfolders, ascending.
+    QVector<int> subtreeTrackIds(int id) const;
+
+    Changes takeChanges();
+
+private:
+    int intern(const QString &dirPath);
+    int create(const QString &name, int parentId, const QString &dirPath);
+    void addToTotals(int id, int delta);
+    // Visits id and its live descendants with their full paths.
+    template <typename Visit>
+    void visitSubtree(int id, Visit visit) const;
+
+    QVector<Directory> dirs_;
+    QVector<int> roots_;
+    QHash<QString, int> ids_;
+    Changes changes_;
+    int liveCount_ = 0;
+};
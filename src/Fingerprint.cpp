@@ -0,0 +1,315 @@
+#include "Fingerprint.h"
+
+#include <QHash>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace {
+constexpr int kFrameSize = 4096;
+constexpr int kFrameHop = kFrameSize / 3;
+constexpr int kChromaBins = 12;
+constexpr double kMinFrequency = 28.0;
+constexpr double kMaxFrequency = 3520.0;
+constexpr double kPi = 3.14159265358979323846;
+// Anti-aliasing filter for the fallback resampler: cutoff as a share of the
+// analysis Nyquist frequency, and taps per unit of decimation on each side.
+constexpr double kLowPassCutoff = 0.9;
+constexpr int kLowPassTapsPerStep = 4;
+
+constexpr int kMinFrames = 16;
+constexpr int kSummaryWords = 8;
+constexpr int kMaxAlignmentOffset = 8;
+constexpr double kDuplicateThreshold = 0.2;
+// Buckets this large come from near-silent or otherwise featureless audio and
+// would turn candidate generation quadratic again.
+constexpr int kMaxBucketSize = 256;
+
+using Chroma = std::array<float, kChromaBins>;
+using Summary = std::array<quint32, kSummaryWords>;
+
+// Radix-2 FFT over split real/imaginary arrays. Twiddles are laid out per
+// stage so every butterfly loop is unit-stride and auto-vectorizes.
+class Fft {
+public:
+    explicit Fft(int size)
+        : size_(size), re_(size), im_(size), bitReverse_(size) {
+        int bits = 0;
+        while ((1 << bits) < size) ++bits;
+        for (int i = 0; i < size; ++i) {
+            int reversed = 0;
+            for (int b = 0; b < bits; ++b) {
+                if (i & (1 << b)) reversed |= 1 << (bits - 1 - b);
+            }
+            bitReverse_[i] = reversed;
+        }
+        for (int half = 1; half < size; half *= 2) {
+            for (int j = 0; j < half; ++j) {
+                const double angle = -kPi * j / half;
+                twiddleRe_.push_back(static_cast<float>(std::cos(angle)));
+                twiddleIm_.push_back(static_cast<float>(std::sin(angle)));
+            }
+        }
+    }
+
+    // Power spectrum of a real frame; out receives size / 2 + 1 values.
+    void powerSpectrum(const float *input, float *out) {
+        for (int i = 0; i < size_; ++i) {
+            re_[bitReverse_[i]] = input[i];
+            im_[bitReverse_[i]] = 0.0f;
+        }
+        const float *wr = twiddleRe_.data();
+        const float *wi = twiddleIm_.data();
+        for (int half = 1; half < size_; half *= 2) {
+            for (int start = 0; start < size_; start += 2 * half) {
+                float *ar = re_.data() + start;
+                float *ai = im_.data() + start;
+                float *br = ar + half;
+                float *bi = ai + half;
+                for (int j = 0; j < half; ++j) {
+                    const float tr = br[j] * wr[j] - bi[j] * wi[j];
+                    const float ti = br[j] * wi[j] + bi[j] * wr[j];
+                    br[j] = ar[j] - tr;
+                    bi[j] = ai[j] - ti;
+                    ar[j] += tr;
+                    ai[j] += ti;
+                }
+            }
+            wr += half;
+            wi += half;
+        }
+        for (int k = 0; k <= size_ / 2; ++k) out[k] = re_[k] * re_[k] + im_[k] * im_[k];
+    }
+
+private:
+    int size_;
+    std::vector<float> re_;
+    std::vector<float> im_;
+    std::vector<int> bitReverse_;
+    std::vector<float> twiddleRe_;
+    std::vector<float> twiddleIm_;
+};
+
+// Blackman-windowed sinc low-pass below the analysis Nyquist frequency, so
+// decimating does not fold higher partials back into the chroma range.
+std::vector<float> lowPass(const qint16 *samples, qint64 count, double step) {
+    const int half = int(std::ceil(kLowPassTapsPerStep * step));
+    const double cutoff = kLowPassCutoff * 0.5 / step; // cycles per input sample
+    std::vector<float> taps(size_t(2 * half + 1));
+    double sum = 0.0;
+    for (int n = -half; n <= half; ++n) {
+        const double x = 2.0 * cutoff * n;
+        const double sinc = n == 0 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+        const double window = 0.42 + 0.5 * std::cos(kPi * n / half) + 0.08 * std::cos(2.0 * kPi * n / half);
+        taps[size_t(n + half)] = static_cast<float>(sinc * window);
+        sum += sinc * window;
+    }
+    for (float &tap : taps) tap = static_cast<float>(tap / sum);
+
+    std::vector<float> out(static_cast<size_t>(count));
+    for (qint64 i = 0; i < count; ++i) {
+        // Edges are filtered as if the signal were zero outside the segment.
+        const qint64 first = std::max<qint64>(0, i - half);
+        const qint64 last = std::min<qint64>(count - 1, i + half);
+        float acc = 0.0f;
+        for (qint64 j = first; j <= last; ++j) acc += taps[size_t(j - i + half)] * samples[j];
+        out[size_t(i)] = acc / 32768.0f;
+    }
+    return out;
+}
+
+std::vector<float> toAnalysisRate(const qint16 *samples, qint64 count, int sampleRate) {
+    std::vector<float> out;
+    if (sampleRate == kFingerprintSampleRate) {
+        out.resize(size_t(count));
+        for (qint64 i = 0; i < count; ++i) out[size_t(i)] = samples[i] / 32768.0f;
+        return out;
+    }
+    // Linear interpolation is plenty for a chroma analysis capped at 3.5 kHz,
+    // once a higher input rate is band-limited.
+    const double step = double(sampleRate) / kFingerprintSampleRate;
+    std::vector<float> input;
+    if (step > 1.0) {
+        input = lowPass(samples, count, step);
+    } else {
+        input.resize(size_t(count));
+        for (qint64 i = 0; i < count; ++i) input[size_t(i)] = samples[i] / 32768.0f;
+    }
+    const qint64 outCount = qint64(count / step);
+    out.resize(size_t(outCount));
+    for (qint64 i = 0; i < outCount; ++i) {
+        const double position = i * step;
+        const qint64 index = qint64(position);
+        const float frac = static_cast<float>(position - index);
+        const float next = index + 1 < count ? input[size_t(index + 1)] : input[size_t(index)];
+        out[size_t(i)] = input[size_t(index)] * (1.0f - frac) + next * frac;
+    }
+    return out;
+}
+
+std::vector<int> chromaBinClasses() {
+    std::vector<int> classes(kFrameSize / 2 + 1, -1);
+    for (int k = 1; k <= kFrameSize / 2; ++k) {
+        const double frequency = double(k) * kFingerprintSampleRate / kFrameSize;
+        if (frequency < kMinFrequency || frequency > kMaxFrequency) continue;
+        const int pitch = int(std::lround(12.0 * std::log2(frequency / 27.5)));
+        classes[k] = ((pitch % kChromaBins) + kChromaBins) % kChromaBins;
+    }
+    return classes;
+}
+
+quint32 subFingerprint(const Chroma &c, const Chroma &previous) {
+    quint32 bits = 0;
+    int bit = 0;
+    const auto push = [&](bool set) {
+        if (set) bits |= 1u << bit;
+        ++bit;
+    };
+    for (int i = 0; i < kChromaBins; ++i) push(c[i] > c[(i + 1) % kChromaBins]);
+    for (int i = 0; i < kChromaBins; ++i) push(c[i] > previous[i]);
+    for (int i = 0; i < 8; ++i) {
+        push(c[i] + c[(i + 1) % kChromaBins] > c[(i + 2) % kChromaBins] + c[(i + 3) % kChromaBins]);
+    }
+    return bits;
+}
+
+// Per-segment majority vote of each sub-fingerprint bit: stable under the bit
+// noise that separates two encodes of one recording.
+Summary summarize(const QVector<quint32> &fingerprint) {
+    Summary summary{};
+    const int frames = fingerprint.size();
+    for (int segment = 0; segment < kSummaryWords; ++segment) {
+        const int begin = segment * frames / kSummaryWords;
+        const int end = (segment + 1) * frames / kSummaryWords;
+        std::array<int, 32> ones{};
+        for (int t = begin; t < end; ++t) {
+            for (int b = 0; b < 32; ++b) ones[b] += (fingerprint[t] >> b) & 1u;
+        }
+        for (int b = 0; b < 32; ++b) {
+            if (2 * ones[b] > end - begin) summary[segment] |= 1u << b;
+        }
+    }
+    return summary;
+}
+
+bool isDegenerate(const Summary &summary) {
+    int bits = 0;
+    for (quint32 word : summary) bits += qPopulationCount(word);
+    return bits < 8 || bits > kSummaryWords * 32 - 8;
+}
+
+int findRoot(std::vector<int> &parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+} // namespace
+
+QVector<quint32> computeFingerprint(const qint16 *samples, qint64 count, int sampleRate) {
+    if (!samples || count <= 0 || sampleRate <= 0) return {};
+    const std::vector<float> mono = toAnalysisRate(samples, count, sampleRate);
+    if (mono.size() < size_t(kFrameSize)) return {};
+
+    std::vector<float> window(kFrameSize);
+    for (int i = 0; i < kFrameSize; ++i) window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / (kFrameSize - 1)));
+    const std::vector<int> classes = chromaBinClasses();
+
+    Fft fft(kFrameSize);
+    std::vector<float> frame(kFrameSize);
+    std::vector<float> power(kFrameSize / 2 + 1);
+    std::vector<Chroma> chroma;
+    for (size_t start = 0; start + kFrameSize <= mono.size(); start += kFrameHop) {
+        for (int i = 0; i < kFrameSize; ++i) frame[i] = mono[start + i] * window[i];
+        fft.powerSpectrum(frame.data(), power.data());
+        Chroma c{};
+        for (int k = 0; k <= kFrameSize / 2; ++k) {
+            if (classes[k] >= 0) c[classes[k]] += power[k];
+        }
+        chroma.push_back(c);
+    }
+
+    // Three-frame moving average, then L2 normalisation so loudness and
+    // encoder gain differences cancel out.
+    std::vector<Chroma> smoothed(chroma.size());
+    for (size_t t = 0; t < chroma.size(); ++t) {
+        const size_t begin = t > 0 ? t - 1 : 0;
+        const size_t end = std::min(chroma.size(), t + 2);
+        Chroma sum{};
+        for (size_t u = begin; u < end; ++u) {
+            for (int i = 0; i < kChromaBins; ++i) sum[i] += chroma[u][i];
+        }
+        float norm = 0.0f;
+        for (float v : sum) norm += v * v;
+        norm = std::sqrt(norm);
+        for (int i = 0; i < kChromaBins; ++i) smoothed[t][i] = norm > 1e-9f ? sum[i] / norm : 0.0f;
+    }
+
+    QVector<quint32> fingerprint;
+    fingerprint.reserve(int(smoothed.size()));
+    for (size_t t = 1; t < smoothed.size(); ++t) fingerprint.append(subFingerprint(smoothed[t], smoothed[t - 1]));
+    return fingerprint;
+}
+
+double fingerprintDistance(const QVector<quint32> &a, const QVector<quint32> &b) {
+    const int minOverlap = std::max(kMinFrames, int(std::min(a.size(), b.size())) / 2);
+    double best = 1.0;
+    for (int offset = -kMaxAlignmentOffset; offset <= kMaxAlignmentOffset; ++offset) {
+        const int ia = std::max(0, offset);
+        const int ib = std::max(0, -offset);
+        const int overlap = int(std::min(a.size() - ia, b.size() - ib));
+        if (overlap < minOverlap) continue;
+        qint64 errors = 0;
+        for (int k = 0; k < overlap; ++k) errors += qPopulationCount(a[ia + k] ^ b[ib + k]);
+        best = std::min(best, errors / (32.0 * overlap));
+    }
+    return best;
+}
+
+QVector<QVector<int>> findDuplicateGroups(const QVector<QVector<quint32>> &fingerprints) {
+    const int count = fingerprints.size();
+    QHash<quint64, QVector<int>> buckets;
+    for (int i = 0; i < count; ++i) {
+        if (fingerprints[i].size() < kMinFrames) continue;
+        const Summary summary = summarize(fingerprints[i]);
+        if (isDegenerate(summary)) continue;
+        for (int band = 0; band < kSummaryWords; ++band) {
+            buckets[(quint64(band) << 32) | summary[band]].append(i);
+        }
+    }
+
+    std::vector<int> parent(static_cast<size_t>(count));
+    std::iota(parent.begin(), parent.end(), 0);
+    for (const QVector<int> &bucket : std::as_const(buckets)) {
+        if (bucket.size() < 2 || bucket.size() > kMaxBucketSize) continue;
+        for (int x = 0; x < bucket.size(); ++x) {
+            for (int y = x + 1; y < bucket.size(); ++y) {
+                const int a = findRoot(parent, bucket[x]);
+                const int b = findRoot(parent, bucket[y]);
+                if (a == b) continue;
+                if (fingerprintDistance(fingerprints[bucket[x]], fingerprints[bucket[y]]) < kDuplicateThreshold) {
+                    parent[std::max(a, b)] = std::min(a, b);
+                }
+            }
+        }
+    }
+
+    QHash<int, QVector<int>> byRoot;
+    for (int i = 0; i < count; ++i) {
+        // Roots are always the smallest index of their set, so they are seen first.
+        const int root = findRoot(parent, i);
+        if (root == i) continue;
+        QVector<int> &group = byRoot[root];
+        if (group.isEmpty()) group.append(root);
+        group.append(i);
+    }
+    QVector<QVector<int>> groups;
+    for (auto it = byRoot.cbegin(); it != byRoot.cend(); ++it) groups.append(it.value());
+    std::sort(groups.begin(), groups.end(), [](const QVector<int> &a, const QVector<int> &b) { return a.first() < b.first(); });
+    return groups;
+}
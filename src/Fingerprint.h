@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+// Chromaprint-style acoustic fingerprinting.
+//
+// A fingerprint is a sequence of 32-bit sub-fingerprints, one per analysis
+// frame, derived from a 12-bin chroma image of a short mono segment. Encodings
+// of the same recording produce sequences with a low bit error rate.
+constexpr int kFingerprintSampleRate = 11025;
+constexpr int kFingerprintSeconds = 30;
+
+QVector<quint32> computeFingerprint(const qint16 *samples, qint64 count, int sampleRate);
+
+// Bit error rate of the best alignment of two fingerprints (0 = identical,
+// ~0.5 = unrelated), or 1.0 when they do not overlap enough to compare.
+double fingerprintDistance(const QVector<quint32> &a, const QVector<quint32> &b);
+
+// Groups (by index, each of size >= 2) of fingerprints that match. Candidates
+// come from locality-sensitive hashing of a per-track bit summary, so the cost
+// grows with the number of tracks rather than the number of pairs.
+QVector<QVector<int>> findDuplicateGroups(const QVector<QVector<quint32>> &fingerprints);
@@ -0,0 +1,182 @@
+#include "FingerprintJob.h"
+#include "CueSheet.h"
+#include "Fingerprint.h"
+#include "MetadataCache.h"
+
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QAudioFormat>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+
+#include <algorithm>
+
+namespace {
+constexpr int kDecoderCount = 2;
+// Cache lookups that can be skipped per event-loop turn, so a fully cached
+// library does not stall the UI while the queue drains.
+constexpr int kSkipBatch = 64;
+constexpr int kSaveInterval = 500;
+} // namespace
+
+FingerprintJob::FingerprintJob(MetadataCache *cache, QObject *parent)
+    : QObject(parent), cache_(cache) {
+    pool_.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+
+    QAudioFormat format;
+    format.setSampleRate(kFingerprintSampleRate);
+    format.setChannelCount(1);
+    format.setSampleFormat(QAudioFormat::Int16);
+
+    for (int i = 0; i < kDecoderCount; ++i) {
+        auto slot = std::make_unique<Decoder>();
+        Decoder *raw = slot.get();
+        raw->decoder = new QAudioDecoder(this);
+        raw->decoder->setAudioFormat(format);
+        connect(raw->decoder, &QAudioDecoder::bufferReady, this, [this, raw]() { readBuffers(*raw); });
+        connect(raw->decoder, &QAudioDecoder::finished, this, [this, raw]() { submit(*raw); });
+        connect(raw->decoder, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), this, [this, raw]() {
+            if (raw->path.isEmpty()) return;
+            ++failed_;
+            raw->decoder->stop();
+            raw->path.clear();
+            raw->samples.clear();
+            QTimer::singleShot(0, this, [this, raw]() { startNext(*raw); });
+        });
+        decoders_.push_back(std::move(slot));
+    }
+}
+
+FingerprintJob::~FingerprintJob() {
+    queue_.clear();
+    pool_.clear();
+    pool_.waitForDone();
+    for (const auto &slot : decoders_) slot->decoder->stop();
+}
+
+void FingerprintJob::enqueue(const QStringList &paths) {
+    for (const QString &path : paths) {
+        // A CUE track shares its audio with the rest of the sheet.
+        if (!isCueTrackPath(path)) queue_.enqueue(path);
+    }
+    for (const auto &slot : decoders_) {
+        if (slot->path.isEmpty()) startNext(*slot);
+    }
+}
+
+void FingerprintJob::rebaseQueued(const QString &fromPrefix, const QString &toPrefix) {
+    QQueue<QString> kept;
+    for (const QString &path : std::as_const(queue_)) {
+        if (!path.startsWith(fromPrefix)) kept.enqueue(path);
+        else if (!toPrefix.isEmpty()) kept.enqueue(toPrefix + path.mid(fromPrefix.size()));
+    }
+    queue_ = kept;
+}
+
+QString FingerprintJob::report() const {
+    QStringList lines;
+    lines << "[Fingerprints]";
+    lines << QString("Computed: %1, failed: %2, queued: %3, analysing: %4")
+                 .arg(completed_).arg(failed_).arg(queue_.size()).arg(inFlight_);
+    lines << QString("Metadata cache entries: %1").arg(cache_->size());
+    return lines.join('\n');
+}
+
+void FingerprintJob::startNext(Decoder &slot) {
+    if (!slot.path.isEmpty()) return;
+    for (int skipped = 0; !queue_.isEmpty(); ++skipped) {
+        if (skipped == kSkipBatch) {
+            QTimer::singleShot(0, this, [this, &slot]() { startNext(slot); });
+            return;
+        }
+        const QString path = queue_.dequeue();
+        const QFileInfo info(path);
+        if (!info.isFile()) continue;
+        const qint64 modifiedMs = info.lastModified().toMSecsSinceEpoch();
+        const TrackMetadata *cached = cache_->findFresh(path, info.size(), modifiedMs);
+        if (cached && !cached->fingerprint.isEmpty()) continue;
+
+        slot.path = path;
+        slot.size = info.size();
+        slot.modifiedMs = modifiedMs;
+        slot.sampleRate = 0;
+        slot.samples.clear();
+        slot.decoder->setSource(QUrl::fromLocalFile(path));
+        slot.decoder->start();
+        return;
+    }
+}
+
+void FingerprintJob::readBuffers(Decoder &slot) {
+    while (slot.decoder->bufferAvailable()) {
+        const QAudioBuffer buffer = slot.decoder->read();
+        if (slot.path.isEmpty() || !buffer.isValid()) continue;
+        const QAudioFormat format = buffer.format();
+        if (slot.sampleRate == 0) slot.sampleRate = format.sampleRate();
+        if (format.sampleRate() != slot.sampleRate) continue;
+
+        const qint64 frames = buffer.frameCount();
+        const int channels = format.channelCount();
+        if (format.sampleFormat() == QAudioFormat::Int16 && channels == 1) {
+            const qint16 *data = buffer.constData<qint16>();
+            slot.samples.insert(slot.samples.end(), data, data + frames);
+        } else {
+            // The backend ignored the requested format: downmix to mono here.
+            const char *data = buffer.constData<char>();
+            const int bytesPerSample = format.bytesPerSample();
+            for (qint64 frame = 0; frame < frames; ++frame) {
+                float sum = 0.0f;
+                for (int c = 0; c < channels; ++c) {
+                    sum += format.normalizedSampleValue(data + (frame * channels + c) * bytesPerSample);
+                }
+                slot.samples.push_back(static_cast<qint16>(qBound(-1.0f, sum / channels, 1.0f) * 32767.0f));
+            }
+        }
+        if (qint64(slot.samples.size()) >= qint64(kFingerprintSeconds) * slot.sampleRate) {
+            slot.decoder->stop();
+            submit(slot);
+            return;
+        }
+    }
+}
+
+void FingerprintJob::submit(Decoder &slot) {
+    if (slot.path.isEmpty()) return;
+    const QString path = slot.path;
+    const qint64 size = slot.size;
+    const qint64 modifiedMs = slot.modifiedMs;
+    const int sampleRate = slot.sampleRate;
+    std::vector<qint16> samples;
+    samples.swap(slot.samples);
+    slot.path.clear();
+
+    ++inFlight_;
+    pool_.start([this, path, size, modifiedMs, sampleRate, samples = std::move(samples)]() {
+        const QVector<quint32> fingerprint = computeFingerprint(samples.data(), qint64(samples.size()), sampleRate);
+        QMetaObject::invokeMethod(this, [this, path, size, modifiedMs, fingerprint]() {
+            store(path, size, modifiedMs, fingerprint);
+        }, Qt::QueuedConnection);
+    });
+    QTimer::singleShot(0, this, [this, &slot]() { startNext(slot); });
+}
+
+void FingerprintJob::store(const QString &path, qint64 size, qint64 modifiedMs, const QVector<quint32> &fingerprint) {
+    --inFlight_;
+    if (fingerprint.isEmpty()) {
+        ++failed_;
+        return;
+    }
+    // The scan recorded this file version; if it changed while we were
+    // decoding, the next scan queues it again.
+    if (!cache_->findFresh(path, size, modifiedMs)) return;
+    cache_->upsert(path).fingerprint = fingerprint;
+    ++completed_;
+    if (++unsaved_ >= kSaveInterval) {
+        cache_->save();
+        unsaved_ = 0;
+    }
+}
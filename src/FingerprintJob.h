@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <memory>
+#include <vector>
+
+class MetadataCache;
+class QAudioDecoder;
+
+// Background fingerprinting of library tracks. A few decoders pull a short
+// mono segment from each queued file; the FFT analysis runs on a private
+// thread pool and results are written to the MetadataCache on this thread.
+class FingerprintJob final : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FingerprintJob(MetadataCache *cache, QObject *parent = nullptr);
+    ~FingerprintJob() override;
+
+    void enqueue(const QStringList &paths);
+    // Rewrites queued paths under fromPrefix to toPrefix, or drops them when
+    // toPrefix is empty. Files already being decoded are left to finish.
+    void rebaseQueued(const QString &fromPrefix, const QString &toPrefix);
+    QString report() const;
+
+private:
+    struct Decoder {
+        QAudioDecoder *decoder = nullptr;
+        QString path;
+        qint64 size = 0;
+        qint64 modifiedMs = 0;
+        int sampleRate = 0;
+        std::vector<qint16> samples;
+    };
+
+    void startNext(Decoder &slot);
+    void readBuffers(Decoder &slot);
+    void submit(Decoder &slot);
+    void store(const QString &path, qint64 size, qint64 modifiedMs, const QVector<quint32> &fingerprint);
+
+    MetadataCache *cache_;
+    QThreadPool pool_;
+    std::vector<std::unique_ptr<Decoder>> decoders_;
+    QQueue<QString> queue_;
+    int inFlight_ = 0;
+    int completed_ = 0;
+    int failed_ = 0;
+    int unsaved_ = 0;
+};
@@ -0,0 +1,186 @@
+#include "Icons.h"
+
+#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QHash>
+#include <QIconEngine>
+#include <QImage>
+#include <QPainter>
+#include <QPalette>
+#include <QPixmap>
+#include <QSvgRenderer>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+struct IconSpec {
+    const char *path; // 24x24 view box
+    QPalette::ColorRole off;
+    QPalette::ColorRole on;
+};
+
+const IconSpec &specOf(Icons::Id id) {
+    static const IconSpec kSpecs[] = {
+        {"M8 5v14l11-7z", QPalette::HighlightedText, QPalette::HighlightedText},
+        {"M6 5h4v14H6zM14 5h4v14h-4z", QPalette::HighlightedText, QPalette::HighlightedText},
+        {"M7 7h10v10H7z", QPalette::PlaceholderText, QPalette::PlaceholderText},
+        {"M6 6h2v12H6zm3.5 6l8.5 6V6z", QPalette::PlaceholderText, QPalette::PlaceholderText},
+        {"M6 18l8.5-6L6 6v12zM16 6v12h2V6h-2z", QPalette::PlaceholderText, QPalette::PlaceholderText},
+        {"M10.59 9.17L5.41 4 4 5.41l5.17 5.17 1.42-1.41zM14.5 4l2.04 2.04L4 18.59 5.41 20 17.96 7.46 20 9.5V4h-5.5z"
+         "m.33 9.41l-1.41 1.41 3.13 3.13L14.5 20H20v-5.5l-2.04 2.04-3.13-3.13z",
+         QPalette::PlaceholderText, QPalette::Highlight},
+        {"M7 7h10v3l4-4-4-4v3H5v6h2V7zm10 10H7v-3l-4 4 4 4v-3h12v-6h-2v4z", QPalette::PlaceholderText, QPalette::Highlight},
+        {"M7 7h10v3l4-4-4-4v3H5v6h2V7zm10 10H7v-3l-4 4 4 4v-3h12v-6h-2v4zm-4-2V9h-1l-2 1v1h1.5v4H13z",
+         QPalette::PlaceholderText, QPalette::Highlight},
+        {"M20 6h-8l-2-2H4c-1.11 0-1.99.89-1.99 2L2 18c0 1.11.89 2 2 2h16c1.11 0 2-.89 2-2V8c0-1.11-.89-2-2-2z"
+         "m-1 8h-3v3h-2v-3h-3v-2h3V9h2v3h3v2z",
+         QPalette::HighlightedText, QPalette::HighlightedText},
+        {"M16 1H4c-1.1 0-2 .9-2 2v14h2V3h12V1zm3 4H8c-1.1 0-2 .9-2 2v14c0 1.1.9 2 2 2h11c1.1 0 2-.9 2-2V7"
+         "c0-1.1-.9-2-2-2zm0 16H8V7h11v14z",
+         QPalette::ButtonText, QPalette::ButtonText},
+        {"M10 4H4c-1.1 0-1.99.9-1.99 2L2 18c0 1.1.9 2 2 2h16c1.1 0 2-.9 2-2V8c0-1.1-.9-2-2-2h-8l-2-2z",
+         QPalette::PlaceholderText, QPalette::PlaceholderText},
+    };
+    static_assert(sizeof(kSpecs) / sizeof(kSpecs[0]) == size_t(Icons::Id::Count), "one spec per icon");
+    return kSpecs[int(id)];
+}
+
+struct PixmapKey {
+    int id;
+    int mode;
+    int state;
+    int width;
+    int height;
+    int ratioPercent;
+    QRgb color;
+
+    bool operator==(const PixmapKey &other) const {
+        return id == other.id && mode == other.mode && state == other.state && width == other.width
+            && height == other.height && ratioPercent == other.ratioPercent && color == other.color;
+    }
+};
+
+size_t qHash(const PixmapKey &key, size_t seed = 0) {
+    return qHashMulti(seed, key.id, key.mode, key.state, key.width, key.height, key.ratioPercent, key.color);
+}
+
+// lastUse orders entries for trimTo(); it is a use counter, not a time.
+struct CachedPixmap {
+    QPixmap pixmap;
+    quint64 lastUse = 0;
+};
+
+QHash<PixmapKey, CachedPixmap> &pixmapCache() {
+    static QHash<PixmapKey, CachedPixmap> cache;
+    // Pixmaps must not outlive the application object.
+    static const bool registered = (qAddPostRoutine([]() { pixmapCache().clear(); }), true);
+    Q_UNUSED(registered);
+    return cache;
+}
+
+int renderCount = 0;
+int hitCount = 0;
+quint64 useCount = 0;
+
+qint64 pixmapBytes(const QPixmap &pixmap) { return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8; }
+
+QPixmap cachedPixmap(Icons::Id id, const QSize &size, qreal ratio, QIcon::Mode mode, QIcon::State state) {
+    if (size.isEmpty()) return {};
+    const IconSpec &spec = specOf(id);
+    QColor color = QGuiApplication::palette().color(state == QIcon::On ? spec.on : spec.off);
+    if (mode == QIcon::Disabled) color.setAlphaF(0.4f);
+    const PixmapKey key{int(id), int(mode), int(state), size.width(), size.height(), int(std::lround(ratio * 100)), color.rgba()};
+
+    QHash<PixmapKey, CachedPixmap> &cache = pixmapCache();
+    const auto it = cache.find(key);
+    if (it != cache.end()) {
+        ++hitCount;
+        it->lastUse = ++useCount;
+        return it->pixmap;
+    }
+
+    const QByteArray svg = QString("<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 24 24\">"
+                                   "<path fill=\"%1\" fill-opacity=\"%2\" d=\"%3\"/></svg>")
+                               .arg(color.name(QColor::HexRgb)).arg(color.alphaF()).arg(QLatin1String(spec.path))
+                               .toUtf8();
+    QImage image(size * ratio, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    QSvgRenderer(svg).render(&painter);
+    painter.end();
+    QPixmap pixmap = QPixmap::fromImage(std::move(image));
+    pixmap.setDevicePixelRatio(ratio);
+    ++renderCount;
+    cache.insert(key, CachedPixmap{pixmap, ++useCount});
+    return pixmap;
+}
+
+class CachedSvgIconEngine final : public QIconEngine {
+public:
+    explicit CachedSvgIconEngine(Icons::Id id) : id_(id) {}
+
+    void paint(QPainter *painter, const QRect &rect, QIcon::Mode mode, QIcon::State state) override {
+        painter->drawPixmap(rect, cachedPixmap(id_, rect.size(), painter->device()->devicePixelRatioF(), mode, state));
+    }
+    QPixmap pixmap(const QSize &size, QIcon::Mode mode, QIcon::State state) override {
+        return cachedPixmap(id_, size, 1.0, mode, state);
+    }
+    QPixmap scaledPixmap(const QSize &size, QIcon::Mode mode, QIcon::State state, qreal scale) override {
+        return cachedPixmap(id_, size, scale, mode, state);
+    }
+    QSize actualSize(const QSize &size, QIcon::Mode, QIcon::State) override { return size; }
+    QIconEngine *clone() const override { return new CachedSvgIconEngine(id_); }
+    QString key() const override { return QStringLiteral("MusicBlueSvg"); }
+
+private:
+    Icons::Id id_;
+};
+} // namespace
+
+namespace Icons {
+const QIcon &icon(Id id) {
+    static const QVector<QIcon> icons = []() {
+        QVector<QIcon> all;
+        for (int i = 0; i < int(Id::Count); ++i) all.append(QIcon(new CachedSvgIconEngine(Id(i))));
+        return all;
+    }();
+    return icons[int(id)];
+}
+
+void prewarm(std::initializer_list<Id> ids, const QSize &size, qreal ratio) {
+    for (Id id : ids) {
+        cachedPixmap(id, size, ratio, QIcon::Normal, QIcon::Off);
+        cachedPixmap(id, size, ratio, QIcon::Normal, QIcon::On);
+    }
+}
+
+qint64 memoryBytes() {
+    qint64 bytes = 0;
+    for (const CachedPixmap &entry : std::as_const(pixmapCache())) bytes += pixmapBytes(entry.pixmap);
+    return bytes;
+}
+
+void trimTo(qint64 bytes) {
+    QHash<PixmapKey, CachedPixmap> &cache = pixmapCache();
+    QVector<QPair<quint64, PixmapKey>> byUse;
+    byUse.reserve(cache.size());
+    qint64 held = 0;
+    for (auto it = cache.cbegin(); it != cache.cend(); ++it) {
+        byUse.append({it->lastUse, it.key()});
+        held += pixmapBytes(it->pixmap);
+    }
+    std::sort(byUse.begin(), byUse.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    for (const auto &entry : std::as_const(byUse)) {
+        if (held <= bytes) break;
+        held -= pixmapBytes(cache.value(entry.second).pixmap);
+        cache.remove(entry.second);
+    }
+}
+
+QString report() {
+    return QString("[Icons]\nCached pixmaps: %1, rendered: %2, cache hits: %3")
+        .arg(pixmapCache().size()).arg(renderCount).arg(hitCount);
+}
+} // namespace Icons
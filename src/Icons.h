@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QIcon>
+#include <QSize>
+#include <QString>
+
+#include <initializer_list>
+
+// Player icons, drawn from built-in SVG paths.
+//
+// Each icon is a single shared QIcon whose engine rasterizes a pixmap once per
+// (size, device pixel ratio, mode, state, colour) and serves it from a cache
+// afterwards, so swapping icons on state changes never touches the style or
+// the SVG renderer. Colours follow the application palette.
+namespace Icons {
+enum class Id { Play, Pause, Stop, Previous, Next, Shuffle, Repeat, RepeatOne, AddFolder, Duplicates, Folder, Count };
+
+const QIcon &icon(Id id);
+
+// Renders ids at size for ratio ahead of first use, in both states.
+void prewarm(std::initializer_list<Id> ids, const QSize &size, qreal ratio);
+
+// Rasterized pixmaps held, and dropping the least recently used down to bytes.
+qint64 memoryBytes();
+void trimTo(qint64 bytes);
+
+QString report();
+} // namespace Icons
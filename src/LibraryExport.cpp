@@ -0,0 +1,176 @@
+#include "LibraryExport.h"
+#include "DirectoryTable.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace {
+constexpr int kStatsChunk = 4096;
+constexpr int kLargestFolders = 10;
+
+QString suffixOf(const QString &path) {
+    const int dot = path.lastIndexOf('.');
+    return dot > path.lastIndexOf('/') ? path.mid(dot + 1).toLower() : QString();
+}
+
+QByteArray csvField(const QString &value) {
+    QByteArray field = value.toUtf8();
+    if (field.contains(',') || field.contains('"') || field.contains('\n') || field.contains('\r')) {
+        field.replace("\"", "\"\"");
+        field = '"' + field + '"';
+    }
+    return field;
+}
+
+QString isoTime(qint64 ms) { return ms > 0 ? QDateTime::fromMSecsSinceEpoch(ms).toString(Qt::ISODate) : QString(); }
+
+QString hexHash(quint64 hash) { return hash != 0 ? QString("%1").arg(hash, 16, 16, QLatin1Char('0')) : QString(); }
+
+QString formatBytes(qint64 bytes) { return QString("%1 MiB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1); }
+
+QString formatDuration(qint64 ms) {
+    const qint64 minutes = ms / 60000;
+    return QString("%1:%2:%3").arg(minutes / 60).arg(minutes % 60, 2, 10, QLatin1Char('0'))
+        .arg(ms / 1000 % 60, 2, 10, QLatin1Char('0'));
+}
+
+struct FormatTotals {
+    int tracks = 0;
+    qint64 bytes = 0;
+    qint64 durationMs = 0;
+};
+
+struct StatsPartial {
+    qint64 bytes = 0;
+    qint64 durationMs = 0;
+    int timedTracks = 0;
+    qint64 plays = 0;
+    QHash<QString, FormatTotals> formats;
+    QHash<int, qint64> folderBytes; // direct tracks only
+};
+} // namespace
+
+bool exportLibrary(const QString &filePath, ExportFormat format, const LibraryColumns &columns, QString *error) {
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    if (format == ExportFormat::Csv) {
+        file.write("id,path,artist,album,format,size_bytes,duration_ms,play_count,last_played,content_hash\n");
+    }
+    QByteArray line;
+    for (int i = 0; i < columns.size(); ++i) {
+        const QString &path = columns.paths[i];
+        if (format == ExportFormat::Csv) {
+            line = QByteArray::number(columns.trackIds[i]) + ',' + csvField(path) + ',' + csvField(columns.artists[i]) + ','
+                 + csvField(columns.albums[i]) + ',' + suffixOf(path).toUtf8() + ',' + QByteArray::number(columns.sizes[i]) + ','
+                 + QByteArray::number(columns.durationsMs[i]) + ',' + QByteArray::number(columns.playCounts[i]) + ','
+                 + isoTime(columns.lastPlayedMs[i]).toUtf8() + ',' + hexHash(columns.contentHashes[i]).toUtf8();
+        } else {
+            line = QJsonDocument(QJsonObject{{"id", columns.trackIds[i]},
+                                             {"path", path},
+                                             {"artist", columns.artists[i]},
+                                             {"album", columns.albums[i]},
+                                             {"format", suffixOf(path)},
+                                             {"sizeBytes", columns.sizes[i]},
+                                             {"durationMs", columns.durationsMs[i]},
+                                             {"playCount", columns.playCounts[i]},
+                                             {"lastPlayed", isoTime(columns.lastPlayedMs[i])},
+                                             {"contentHash", hexHash(columns.contentHashes[i])}})
+                       .toJson(QJsonDocument::Compact);
+        }
+        line += '\n';
+        if (file.write(line) != line.size()) break;
+    }
+    if (!file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString libraryStatsReport(const LibraryColumns &columns, const DirectoryTable &directories) {
+    const int chunkCount = (columns.size() + kStatsChunk - 1) / kStatsChunk;
+    std::vector<StatsPartial> partials(size_t(std::max(chunkCount, 1)));
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+        for (int chunk = 0; chunk < chunkCount; ++chunk) {
+            pool.start([&columns, &partials, chunk]() {
+                StatsPartial &partial = partials[size_t(chunk)];
+                const int end = std::min(columns.size(), (chunk + 1) * kStatsChunk);
+                for (int i = chunk * kStatsChunk; i < end; ++i) {
+                    const qint64 bytes = columns.sizes[i];
+                    const qint64 duration = columns.durationsMs[i];
+                    partial.bytes += bytes;
+                    partial.durationMs += duration;
+                    partial.timedTracks += duration > 0 ? 1 : 0;
+                    partial.plays += columns.playCounts[i];
+                    FormatTotals &format = partial.formats[suffixOf(columns.paths[i])];
+                    ++format.tracks;
+                    format.bytes += bytes;
+                    format.durationMs += duration;
+                    if (columns.folderIds[i] >= 0) partial.folderBytes[columns.folderIds[i]] += bytes;
+                }
+            });
+        }
+        pool.waitForDone();
+    }
+
+    StatsPartial total;
+    for (const StatsPartial &partial : partials) {
+        total.bytes += partial.bytes;
+        total.durationMs += partial.durationMs;
+        total.timedTracks += partial.timedTracks;
+        total.plays += partial.plays;
+        for (auto it = partial.formats.cbegin(); it != partial.formats.cend(); ++it) {
+            FormatTotals &format = total.formats[it.key()];
+            format.tracks += it->tracks;
+            format.bytes += it->bytes;
+            format.durationMs += it->durationMs;
+        }
+        for (auto it = partial.folderBytes.cbegin(); it != partial.folderBytes.cend(); ++it) total.folderBytes[it.key()] += it.value();
+    }
+    // Folder sizes include their subfolders.
+    QHash<int, qint64> subtreeBytes;
+    for (auto it = total.folderBytes.cbegin(); it != total.folderBytes.cend(); ++it) {
+        for (int id = it.key(); id >= 0; id = directories.directory(id).parentId) subtreeBytes[id] += it.value();
+    }
+
+    QStringList lines;
+    lines << "[Library stats]";
+    lines << QString("Tracks: %1, size: %2, plays: %3").arg(columns.size()).arg(formatBytes(total.bytes)).arg(total.plays);
+    lines << QString("Duration: %1 (%2 of %3 tracks timed)")
+                 .arg(formatDuration(total.durationMs)).arg(total.timedTracks).arg(columns.size());
+    QStringList formatNames = total.formats.keys();
+    std::sort(formatNames.begin(), formatNames.end(), [&](const QString &a, const QString &b) {
+        return total.formats[a].tracks > total.formats[b].tracks;
+    });
+    for (const QString &name : std::as_const(formatNames)) {
+        const FormatTotals &format = total.formats[name];
+        lines << QString("  %1: %2 tracks, %3, %4").arg(name.isEmpty() ? QString("(none)") : name, -5)
+                     .arg(format.tracks).arg(formatBytes(format.bytes)).arg(formatDuration(format.durationMs));
+    }
+    QVector<QPair<qint64, int>> folders;
+    folders.reserve(subtreeBytes.size());
+    for (auto it = subtreeBytes.cbegin(); it != subtreeBytes.cend(); ++it) folders.append({it.value(), it.key()});
+    const int shown = std::min(kLargestFolders, int(folders.size()));
+    std::partial_sort(folders.begin(), folders.begin() + shown, folders.end(), std::greater<>());
+    lines << "Largest folders:";
+    for (int i = 0; i < shown; ++i) {
+        const int id = folders[i].second;
+        lines << QString("  %1  %2 (%3 tracks)").arg(formatBytes(folders[i].first), 12)
+                     .arg(directories.path(id)).arg(directories.directory(id).totalTracks);
+    }
+    return lines.join('\n');
+}
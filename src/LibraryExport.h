@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class DirectoryTable;
+
+// The library as parallel columns, one entry per track, gathered once on the
+// UI thread so exports and statistics never touch the models.
+struct LibraryColumns {
+    QVector<int> trackIds;
+    QStringList paths;
+    QStringList artists;
+    QStringList albums;
+    QVector<int> folderIds;
+    QVector<qint64> sizes;
+    QVector<qint64> durationsMs; // 0 when unknown
+    QVector<int> playCounts;
+    QVector<qint64> lastPlayedMs;
+    QVector<quint64> contentHashes;
+
+    int size() const { return int(trackIds.size()); }
+};
+
+enum class ExportFormat { Csv, JsonLines };
+
+// Writes one row per track, streaming to filePath; the file is replaced only
+// once everything was written.
+bool exportLibrary(const QString &filePath, ExportFormat format, const LibraryColumns &columns, QString *error);
+
+// Totals, format breakdown and the largest folders, computed in one parallel
+// pass over the columns.
+QString libraryStatsReport(const LibraryColumns &columns, const DirectoryTable &directories);
@@ -0,0 +1,87 @@
+#include "LibraryIndex.h"
+
+#include <algorithm>
+
+namespace {
+QString groupKey(const QString &name) { return name.toCaseFolded().simplified(); }
+} // namespace
+
+int LibraryIndex::addTrack(int trackId, const QString &filePath, const QString &artist, const QString &album) {
+    const QString artistName = artist.trimmed().isEmpty() ? QString("不明なアーティスト") : artist.trimmed();
+    const QString albumName = album.trimmed().isEmpty() ? QString("不明なアルバム") : album.trimmed();
+    const int artistId = internArtist(artistName);
+
+    const QPair<int, QString> key(artistId, groupKey(albumName));
+    auto it = albumIds_.constFind(key);
+    if (it == albumIds_.cend()) {
+        Album entry;
+        entry.name = albumName;
+        entry.artistId = artistId;
+        albums_.append(entry);
+        it = albumIds_.insert(key, int(albums_.size()) - 1);
+    }
+    const int albumId = it.value();
+    if (albums_[albumId].trackIds.isEmpty()) {
+        // New, or emptied by removeTracks(): (re)join the artist's sorted list.
+        QVector<int> &artistAlbums = artists_[artistId].albumIds;
+        artistAlbums.insert(std::lower_bound(artistAlbums.begin(), artistAlbums.end(), albumId), albumId);
+        albums_[albumId].coverSource = filePath;
+    }
+    albums_[albumId].trackIds.append(trackId);
+    if (trackId >= trackAlbums_.size()) trackAlbums_.resize(trackId + 1, -1);
+    trackAlbums_[trackId] = albumId;
+    ++artists_[artistId].trackCount;
+    return albumId;
+}
+
+void LibraryIndex::clear() {
+    artists_.clear();
+    albums_.clear();
+    artistIds_.clear();
+    albumIds_.clear();
+    trackAlbums_.clear();
+}
+
+void LibraryIndex::removeTracks(const QVector<int> &sortedTrackIds) {
+    QHash<int, int> removedPerAlbum;
+    for (int trackId : sortedTrackIds) {
+        if (trackId < 0 || trackId >= trackAlbums_.size() || trackAlbums_[trackId] < 0) continue;
+        ++removedPerAlbum[trackAlbums_[trackId]];
+        trackAlbums_[trackId] = -1;
+    }
+    for (auto it = removedPerAlbum.cbegin(); it != removedPerAlbum.cend(); ++it) {
+        Album &album = albums_[it.key()];
+        album.trackIds.erase(std::remove_if(album.trackIds.begin(), album.trackIds.end(), [&](int trackId) {
+            return std::binary_search(sortedTrackIds.cbegin(), sortedTrackIds.cend(), trackId);
+        }), album.trackIds.end());
+        Artist &artist = artists_[album.artistId];
+        artist.trackCount -= it.value();
+        if (album.trackIds.isEmpty()) artist.albumIds.removeOne(it.key());
+    }
+}
+
+void LibraryIndex::relinkCoverSources(const QHash<QString, QString> &moved) {
+    for (Album &album : albums_) album.coverSource = moved.value(album.coverSource, album.coverSource);
+}
+
+QVector<int> LibraryIndex::artistTrackIds(int artistId) const {
+    QVector<int> ids;
+    if (artistId < 0 || artistId >= artists_.size()) return ids;
+    const Artist &artist = artists_[artistId];
+    ids.reserve(artist.trackCount);
+    for (int albumId : artist.albumIds) ids += albums_[albumId].trackIds;
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+int LibraryIndex::internArtist(const QString &name) {
+    const QString key = groupKey(name);
+    const auto it = artistIds_.constFind(key);
+    if (it != artistIds_.cend()) return it.value();
+    Artist entry;
+    entry.name = name;
+    artists_.append(entry);
+    const int id = int(artists_.size()) - 1;
+    artistIds_.insert(key, id);
+    return id;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+// Artist and album groupings of the library, maintained as tracks are indexed.
+//
+// Names are interned to dense integer IDs on first sight (case-insensitively)
+// and every group keeps its member IDs sorted, so browse views only read
+// precomputed vectors instead of grouping the track list on demand.
+class LibraryIndex final {
+public:
+    struct Artist {
+        QString name;
+        QVector<int> albumIds;
+        int trackCount = 0;
+    };
+
+    struct Album {
+        QString name;
+        int artistId = -1;
+        QVector<int> trackIds;
+        // A member track whose folder or tags supply the album artwork.
+        QString coverSource;
+    };
+
+    // Track IDs must be added in increasing order; returns the album ID.
+    int addTrack(int trackId, const QString &filePath, const QString &artist, const QString &album);
+    void clear();
+    // Drops tracks (ascending IDs) from their albums and artists. Emptied
+    // groups keep their IDs but no longer count towards their artist.
+    void removeTracks(const QVector<int> &sortedTrackIds);
+    // Follows moved files (old path -> new path) in the album cover sources.
+    void relinkCoverSources(const QHash<QString, QString> &moved);
+
+    const QVector<Artist> &artists() const { return artists_; }
+    const QVector<Album> &albums() const { return albums_; }
+    QVector<int> artistTrackIds(int artistId) const;
+    // Album of a track, or -1 once it was removed.
+    int albumOfTrack(int trackId) const { return trackAlbums_.value(trackId, -1); }
+
+private:
+    int internArtist(const QString &name);
+
+    QVector<Artist> artists_;
+    QVector<Album> albums_;
+    QHash<QString, int> artistIds_;
+    QHash<QPair<int, QString>, int> albumIds_;
+    QVector<int> trackAlbums_; // album ID by track ID, -1 once removed
+};
@@ -0,0 +1,285 @@
+#include "LibraryScanner.h"
+#include "BatchedHash.h"
+#include "ContentHash.h"
+#include "CueSheet.h"
+#include "MetadataCache.h"
+#include "TagReader.h"
+
+#include <QBitArray>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QThread>
+#include <QThreadPool>
+
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+
+namespace {
+constexpr int kProbeBatch = 64;
+constexpr int kMinProbeThreads = 4;
+
+const QLatin1String kAudioSuffixes[] = {QLatin1String("mp3"), QLatin1String("flac"), QLatin1String("wav"),
+                                        QLatin1String("ogg"), QLatin1String("m4a"), QLatin1String("aac")};
+
+QStringView suffixOf(QStringView name) {
+    const qsizetype dot = name.lastIndexOf('.');
+    return dot < 0 ? QStringView() : name.mid(dot + 1);
+}
+
+bool hasAudioSuffix(QStringView name) {
+    const QStringView suffix = suffixOf(name);
+    for (const QLatin1String &audio : kAudioSuffixes) {
+        if (suffix.compare(audio, Qt::CaseInsensitive) == 0) return true;
+    }
+    return false;
+}
+
+bool isCueSheetName(QStringView name) { return suffixOf(name).compare(QLatin1String("cue"), Qt::CaseInsensitive) == 0; }
+
+#ifdef Q_OS_UNIX
+qint64 modifiedMsOf(const struct stat &st) {
+#ifdef Q_OS_DARWIN
+    return qint64(st.st_mtimespec.tv_sec) * 1000 + st.st_mtimespec.tv_nsec / 1000000;
+#else
+    return qint64(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+#endif
+}
+
+// Lists regular files below root the way QDirIterator with QDir::Files and
+// Subdirectories does: hidden entries are skipped, symlinks to files are
+// listed and symlinked folders are not entered. Paths are built from the
+// folder path and the entry name; d_type spares a stat for everything but
+// the files want(path, name) accepts, which are stat()ed relative to the
+// open folder and passed to visit(path, st).
+template <typename Want, typename Visit>
+void walkFiles(const QString &root, Want want, Visit visit) {
+    QStringList folders{root};
+    while (!folders.isEmpty()) {
+        const QString folder = folders.takeLast();
+        DIR *dir = opendir(QFile::encodeName(folder).constData());
+        if (!dir) continue;
+        const int fd = dirfd(dir);
+        while (const dirent *entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;
+            unsigned char type = entry->d_type;
+            struct stat st;
+            bool statted = false;
+            if (type == DT_UNKNOWN) {
+                if (fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISLNK(st.st_mode) ? DT_LNK : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+                statted = type == DT_REG;
+            }
+            const QString name = QFile::decodeName(entry->d_name);
+            QString path = folder;
+            if (!path.endsWith('/')) path += '/';
+            path += name;
+            if (type == DT_DIR) {
+                folders.append(path);
+                continue;
+            }
+            if ((type != DT_REG && type != DT_LNK) || !want(path, name)) continue;
+            if (!statted && fstatat(fd, entry->d_name, &st, 0) != 0) continue;
+            if (S_ISREG(st.st_mode)) visit(path, st);
+        }
+        closedir(dir);
+    }
+}
+#endif
+
+} // namespace
+
+QString folderNameOf(const QString &filePath) {
+    const qsizetype end = filePath.lastIndexOf('/');
+    if (end <= 0) return QString();
+    const qsizetype begin = filePath.lastIndexOf('/', end - 1) + 1;
+    return filePath.mid(begin, end - begin);
+}
+
+bool isAudioFile(const QString &path) { return hasAudioSuffix(QStringView(path).mid(path.lastIndexOf('/') + 1)); }
+
+QVector<ScannedFile> scanAudioFiles(const QString &root, const QSet<QString> &known, QStringList *replaced) {
+    QVector<ScannedFile> files;
+    QStringList cuePaths;
+    QHash<QString, int> fileIndexes;
+    QSet<QString> knownAudio;
+    const auto add = [&](const QString &filePath, qint64 size, qint64 modifiedMs) {
+        ScannedFile file;
+        file.path = filePath;
+        file.size = size;
+        file.modifiedMs = modifiedMs;
+        fileIndexes.insert(filePath, int(files.size()));
+        files.append(file);
+    };
+#ifdef Q_OS_UNIX
+    // Known files and CUE sheets need no stat.
+    walkFiles(root, [&](const QString &path, const QString &name) {
+        if (isCueSheetName(name)) {
+            cuePaths.append(path);
+            return false;
+        }
+        if (!hasAudioSuffix(name)) return false;
+        if (!known.contains(path)) return true;
+        knownAudio.insert(path);
+        return false;
+    }, [&](const QString &path, const struct stat &st) {
+        add(path, qint64(st.st_size), modifiedMsOf(st));
+    });
+#else
+    QDirIterator it(root, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString filePath = it.next();
+        const QString name = it.fileName();
+        if (isCueSheetName(name)) {
+            cuePaths.append(filePath);
+            continue;
+        }
+        if (!hasAudioSuffix(name)) continue;
+        if (known.contains(filePath)) {
+            knownAudio.insert(filePath);
+            continue;
+        }
+        const QFileInfo info = it.fileInfo();
+        add(filePath, info.size(), info.lastModified().toMSecsSinceEpoch());
+    }
+#endif
+
+    // Tracks already in the library are skipped one by one, so a sheet
+    // still replaces its file when only some of its tracks are known. A sheet
+    // for a file that is in the library as a whole (scanned before the sheet
+    // appeared) lists its tracks too, and the file goes to replaced.
+    QBitArray split(files.size());
+    QVector<ScannedFile> tracks;
+    for (const QString &cuePath : std::as_const(cuePaths)) {
+        CueSheet sheet;
+        if (!readCueSheet(cuePath, &sheet) || sheet.tracks.isEmpty()) continue;
+        int index = fileIndexes.value(sheet.audioPath, -1);
+        if (index < 0 && knownAudio.remove(sheet.audioPath)) {
+            const QFileInfo info(sheet.audioPath);
+            add(sheet.audioPath, info.size(), info.lastModified().toMSecsSinceEpoch());
+            split.resize(files.size());
+            index = int(files.size()) - 1;
+            if (replaced) replaced->append(sheet.audioPath);
+        }
+        if (index < 0 || split.testBit(index)) continue;
+        split.setBit(index);
+        for (const CueTrack &track : std::as_const(sheet.tracks)) {
+            ScannedFile file = files[index];
+            file.path = cueTrackPath(cuePath, track.number);
+            if (known.contains(file.path)) continue;
+            file.artist = track.performer.isEmpty() ? sheet.performer : track.performer;
+            file.album = sheet.title.isEmpty() ? folderNameOf(cuePath) : sheet.title;
+            file.tagsRead = true;
+            tracks.append(file);
+        }
+    }
+    QVector<ScannedFile> kept;
+    kept.reserve(files.size() + tracks.size());
+    for (int i = 0; i < files.size(); ++i) {
+        if (!split.testBit(i)) kept.append(files[i]);
+    }
+    kept += tracks;
+    return kept;
+}
+
+QString firstAudioFile(const QString &root) {
+    const QDir dir(root);
+    for (const QString &name : dir.entryList(QDir::Files, QDir::Name)) {
+        if (hasAudioSuffix(name)) return dir.filePath(name);
+    }
+    // Like the walk, symlinked folders are not entered.
+    for (const QString &name : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks, QDir::Name)) {
+        const QString found = firstAudioFile(dir.filePath(name));
+        if (!found.isEmpty()) return found;
+    }
+    return QString();
+}
+
+void probeScannedFiles(QVector<ScannedFile> &files, const MetadataCache &cache, ProbeStats *stats) {
+    QElapsedTimer timer;
+    timer.start();
+    QVector<int> pending;
+    for (int i = 0; i < files.size(); ++i) {
+        ScannedFile &file = files[i];
+        if (isCueTrackPath(file.path)) continue;
+        const TrackMetadata *cached = cache.findFresh(file.path, file.size, file.modifiedMs);
+        if (cached && cached->contentHash != 0) {
+            file.contentHash = cached->contentHash;
+            file.artist = cached->artist;
+            file.album = cached->album;
+            file.durationMs = cached->durationMs;
+            // Records from before duration probing only need the probe.
+            if (file.durationMs <= 0) pending.append(i);
+        } else {
+            pending.append(i);
+        }
+    }
+    ProbeStats result;
+    result.probed = int(pending.size());
+    if (pending.isEmpty()) {
+        if (stats) *stats = result;
+        return;
+    }
+
+    // Edge reads of unknown files go through one batch first; tag and
+    // duration sniffing below seek based on what they read, so they stay
+    // on the pool. MUSICPLAYER_PROBE_BACKEND=threads skips the batch for
+    // comparison.
+    QStringList hashPaths;
+    QVector<qint64> hashSizes;
+    QVector<int> hashSlots;
+    for (int k = 0; k < pending.size(); ++k) {
+        const ScannedFile &file = files[pending[k]];
+        if (file.contentHash != 0) continue;
+        hashPaths.append(file.path);
+        hashSizes.append(file.size);
+        hashSlots.append(k);
+    }
+    // One per pending file; 0 when the workers still have to hash it.
+    QVector<quint64> pendingHashes(pending.size(), 0);
+    QVector<quint64> hashes;
+    if (!hashPaths.isEmpty() && qEnvironmentVariable("MUSICPLAYER_PROBE_BACKEND") != "threads"
+        && batchedContentHashes(hashPaths, hashSizes, &hashes)) {
+        result.ioUring = true;
+        for (int j = 0; j < hashSlots.size(); ++j) {
+            pendingHashes[hashSlots[j]] = hashes[j];
+            if (hashes[j] != 0) ++result.hashedInBatch;
+        }
+    }
+
+    // Workers write disjoint elements through a raw pointer so no QList
+    // detach check runs concurrently.
+    ScannedFile *data = files.data();
+    const int *indexes = pending.constData();
+    const quint64 *known = pendingHashes.constData();
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(kMinProbeThreads, QThread::idealThreadCount()));
+    for (int begin = 0; begin < pending.size(); begin += kProbeBatch) {
+        const int end = std::min(begin + kProbeBatch, int(pending.size()));
+        pool.start([data, indexes, known, begin, end]() {
+            for (int k = begin; k < end; ++k) {
+                ScannedFile &file = data[indexes[k]];
+                if (file.contentHash == 0) {
+                    file.contentHash = known[k] != 0 ? known[k] : partialContentHash(file.path, file.size);
+                    const TrackTags tags = readTags(file.path);
+                    file.artist = tags.albumArtist.isEmpty() ? tags.artist : tags.albumArtist;
+                    file.album = tags.album.isEmpty() ? folderNameOf(file.path) : tags.album;
+                    file.tagsRead = true;
+                }
+                file.durationMs = readDurationMs(file.path);
+            }
+        });
+    }
+    pool.waitForDone();
+    result.elapsedMs = timer.elapsed();
+    if (stats) *stats = result;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class MetadataCache;
+
+struct ScannedFile {
+    QString path;
+    qint64 size = 0;
+    qint64 modifiedMs = 0;
+    quint64 contentHash = 0;
+    // Grouping tags: album artist (falling back to artist) and album (falling
+    // back to the folder name). tagsRead is false when they came from the cache.
+    QString artist;
+    QString album;
+    bool tagsRead = false;
+    qint64 durationMs = 0; // from container headers, 0 when unknown
+};
+
+// Whether the file name has one of the extensions the scanner picks up.
+bool isAudioFile(const QString &path);
+// Last folder name of a file path, without QFileInfo: the album of files
+// whose tags name none.
+QString folderNameOf(const QString &filePath);
+
+// Audio files below root whose paths are not in known. A file split by a CUE
+// sheet next to it is listed as its tracks instead (see CueSheet.h); those
+// carry the audio file's size and mtime and their tags come from the sheet.
+// Known audio files that a sheet splits go to replaced: the caller drops them,
+// their tracks are among the results. On Unix the walk uses readdir()
+// directly and only stats new audio files and known ones a sheet splits.
+QVector<ScannedFile> scanAudioFiles(const QString &root, const QSet<QString> &known, QStringList *replaced = nullptr);
+// The first audio file below root in name order, a folder's own files before
+// its subfolders. Stops at the first hit instead of walking the whole tree;
+// empty when there is none.
+QString firstAudioFile(const QString &root);
+
+// What the last probeScannedFiles() did, for the diagnostics window.
+struct ProbeStats {
+    int probed = 0;        // files that needed hashing or a duration probe
+    int hashedInBatch = 0; // hashed through io_uring (see BatchedHash.h)
+    qint64 elapsedMs = 0;
+    bool ioUring = false;
+};
+
+// Fills in contentHash, tags and duration for every file: unchanged files
+// reuse cached values, the rest are hashed and probed in parallel (the work
+// is I/O bound on network shares). CUE tracks are left as they are.
+// Hashes of new files are read in one batch where io_uring is available.
+void probeScannedFiles(QVector<ScannedFile> &files, const MetadataCache &cache, ProbeStats *stats = nullptr);
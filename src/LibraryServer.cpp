@@ -0,0 +1,380 @@
+#include "LibraryServer.h"
+#include "ContentHash.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrlQuery>
+
+#include <algorithm>
+#include <limits>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <sys/sendfile.h>
+#endif
+
+namespace {
+constexpr int kMaxHeaderBytes = 16 * 1024;
+constexpr int kIdleTimeoutMs = 30000;
+constexpr qint64 kSendChunk = 256 * 1024;
+constexpr int kGrowPollMs = 250;
+
+QByteArray contentType(const QString &path) {
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "mp3") return "audio/mpeg";
+    if (suffix == "flac") return "audio/flac";
+    if (suffix == "wav") return "audio/wav";
+    if (suffix == "ogg" || suffix == "opus") return "audio/ogg";
+    if (suffix == "m4a") return "audio/mp4";
+    if (suffix == "aac") return "audio/aac";
+    return "application/octet-stream";
+}
+
+enum class RangeKind { Whole, Partial, Unsatisfiable };
+
+// Single "bytes=" ranges only; anything fancier is answered with the whole
+// file, which RFC 9110 allows.
+RangeKind parseRange(const QByteArray &header, qint64 size, qint64 *first, qint64 *last) {
+    *first = 0;
+    *last = size - 1;
+    if (!header.startsWith("bytes=") || header.contains(',')) return RangeKind::Whole;
+    const QByteArray spec = header.mid(6).trimmed();
+    const int dash = spec.indexOf('-');
+    if (dash < 0) return RangeKind::Whole;
+    bool okFirst = false;
+    bool okLast = false;
+    const qint64 from = spec.left(dash).toLongLong(&okFirst);
+    const qint64 to = spec.mid(dash + 1).toLongLong(&okLast);
+    if (dash == 0) {
+        // Suffix range: the last n bytes.
+        if (!okLast || to <= 0) return RangeKind::Unsatisfiable;
+        *first = std::max<qint64>(0, size - to);
+    } else {
+        if (!okFirst || from >= size) return RangeKind::Unsatisfiable;
+        *first = from;
+        if (dash + 1 < spec.size()) {
+            if (!okLast || to < from) return RangeKind::Whole;
+            *last = std::min(to, size - 1);
+        }
+    }
+    return RangeKind::Partial;
+}
+} // namespace
+
+// One client: reads a request, writes the response, then closes (no
+// keep-alive; media clients open a connection per range anyway).
+class LibraryServer::Connection final : public QObject {
+public:
+    Connection(QTcpSocket *socket, LibraryServer *server)
+        : QObject(server), server_(server), socket_(socket) {
+        socket_->setParent(this);
+        ++server_->clients_;
+        idle_.setSingleShot(true);
+        idle_.start(kIdleTimeoutMs);
+        connect(&idle_, &QTimer::timeout, socket_, &QTcpSocket::abort);
+        connect(socket_, &QTcpSocket::readyRead, this, [this]() { readRequest(); });
+        connect(socket_, &QTcpSocket::bytesWritten, this, [this]() { resumeBody(); });
+        connect(socket_, &QTcpSocket::disconnected, this, &QObject::deleteLater);
+    }
+    ~Connection() override { --server_->clients_; }
+
+private:
+    void readRequest() {
+        if (responded_) return;
+        request_ += socket_->readAll();
+        const int end = request_.indexOf("\r\n\r\n");
+        if (end < 0) {
+            if (request_.size() > kMaxHeaderBytes) respondError(431, "Request Header Fields Too Large");
+            return;
+        }
+        responded_ = true;
+        ++server_->requests_;
+        const QList<QByteArray> lines = request_.left(end).split('\n');
+        const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        if (requestLine.size() < 2) return respondError(400, "Bad Request");
+        const QByteArray method = requestLine[0];
+        const QList<QByteArray> targetParts = requestLine[1].split('?');
+        const QByteArray target = targetParts.first();
+        const QUrlQuery query(targetParts.size() > 1 ? QString::fromUtf8(targetParts[1]) : QString());
+        head_ = method == "HEAD";
+        if (method != "GET" && !head_) return respondError(405, "Method Not Allowed");
+        QByteArray range;
+        for (const QByteArray &line : lines.mid(1)) {
+            const int colon = line.indexOf(':');
+            if (colon > 0 && line.left(colon).trimmed().toLower() == "range") range = line.mid(colon + 1).trimmed();
+        }
+
+        if (target == "/tracks") {
+            const QByteArray &body = server_->listing();
+            writeHeader(200, "OK", {{"Content-Type", "application/json; charset=utf-8"}}, body.size());
+            if (!head_) socket_->write(body);
+            return close();
+        }
+        if (!target.startsWith("/tracks/")) return respondError(404, "Not Found");
+        bool ok = false;
+        const int id = target.mid(8).toInt(&ok);
+        const auto it = server_->trackIndex_.constFind(id);
+        if (!ok || it == server_->trackIndex_.cend()) return respondError(404, "Not Found");
+        const QString path = server_->tracks_[it.value()].path;
+        Transcoder::Profile profile;
+        if (!query.hasQueryItem("profile") || !Transcoder::parseProfile(query.queryItemValue("profile"), &profile)
+            || Transcoder::matches(QFileInfo(path).suffix(), profile)) {
+            return serveFile(path, range);
+        }
+        serveTranscoded(path, profile, range);
+    }
+
+    void serveTranscoded(const QString &path, Transcoder::Profile profile, const QByteArray &range) {
+        const quint64 hash = partialContentHash(path, QFileInfo(path).size());
+        Transcoder &transcoder = server_->transcoder_;
+        const QString cached = hash != 0 ? transcoder.cachedOutput(hash, profile) : QString();
+        if (!cached.isEmpty()) return serveFile(cached, range);
+        // Nothing goes out before the job has written something; the idle
+        // timeout starts with the body.
+        idle_.stop();
+        const QString key = Transcoder::key(hash, profile);
+        waiting_ = connect(&transcoder, &Transcoder::finished, this, [this, key, path, range](const QString &doneKey, const QString &output) {
+            if (doneKey != key) return;
+            disconnect(waiting_);
+            poll_.stop();
+            if (!streaming_) return serveFile(output.isEmpty() ? path : output, range);
+            // The bytes sent so far came from this very file, before its rename.
+            // A failed job leaves the client with a short body.
+            if (output.isEmpty()) return close();
+            growing_ = output;
+            finalSize_ = QFileInfo(output).size();
+            resumeBody();
+        });
+        transcoder.request(path, hash, profile);
+        // Ranges past the start need the final size: those clients wait for
+        // the whole job. Everyone else gets the output as it grows.
+        qint64 first = 0;
+        qint64 last = 0;
+        const qint64 open = std::numeric_limits<qint64>::max();
+        if (!range.isEmpty() && parseRange(range, open, &first, &last) != RangeKind::Whole && (first != 0 || last != open - 1)) return;
+        poll_.setInterval(kGrowPollMs);
+        connect(&poll_, &QTimer::timeout, this, [this, key]() {
+            if (!streaming_) {
+                const QString part = server_->transcoder_.partialOutput(key);
+                if (part.isEmpty() || QFileInfo(part).size() == 0) return;
+                // No length yet: the body ends with the connection.
+                streaming_ = true;
+                growing_ = part;
+                writeHeader(200, "OK", {{"Content-Type", contentType(part)}}, -1);
+                if (head_) return close();
+            }
+            resumeBody();
+        });
+        poll_.start();
+    }
+
+    // Sends what the transcoder has written past offset_. The file is opened
+    // afresh every time so the rename at the end of the job does not matter.
+    void resumeGrowing() {
+        QFile file(growing_);
+        if (!file.open(QIODevice::ReadOnly) || !file.seek(offset_)) return close();
+        while (socket_->bytesToWrite() < kSendChunk) {
+            const QByteArray chunk = file.read(kSendChunk);
+            if (chunk.isEmpty()) break;
+            socket_->write(chunk);
+            offset_ += chunk.size();
+            server_->bytesCopied_ += chunk.size();
+            idle_.start(kIdleTimeoutMs);
+        }
+        if (finalSize_ >= 0 && offset_ >= finalSize_) close();
+    }
+
+    void serveFile(const QString &path, const QByteArray &range) {
+        file_.setFileName(path);
+        if (!file_.open(QIODevice::ReadOnly)) return respondError(404, "Not Found");
+        const qint64 size = file_.size();
+        qint64 first = 0;
+        qint64 last = size - 1;
+        const RangeKind kind = range.isEmpty() ? RangeKind::Whole : parseRange(range, size, &first, &last);
+        if (kind == RangeKind::Unsatisfiable || (size == 0 && kind == RangeKind::Partial)) {
+            writeHeader(416, "Range Not Satisfiable", {{"Content-Range", "bytes */" + QByteArray::number(size)}}, 0);
+            return close();
+        }
+        QList<QPair<QByteArray, QByteArray>> headers{{"Content-Type", contentType(path)}, {"Accept-Ranges", "bytes"}};
+        if (kind == RangeKind::Partial) {
+            headers.append({"Content-Range", "bytes " + QByteArray::number(first) + '-' + QByteArray::number(last) + '/'
+                                                 + QByteArray::number(size)});
+            writeHeader(206, "Partial Content", headers, last - first + 1);
+        } else {
+            writeHeader(200, "OK", headers, size);
+        }
+        if (head_ || size == 0) return close();
+        offset_ = first;
+        remaining_ = last - first + 1;
+        if (!file_.seek(offset_)) return close();
+        resumeBody();
+    }
+
+    void writeHeader(int status, const QByteArray &reason, const QList<QPair<QByteArray, QByteArray>> &headers, qint64 length) {
+        QByteArray header = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n";
+        for (const auto &entry : headers) header += entry.first + ": " + entry.second + "\r\n";
+        if (length >= 0) header += "Content-Length: " + QByteArray::number(length) + "\r\n";
+        header += "Connection: close\r\n\r\n";
+        socket_->write(header);
+    }
+
+    void respondError(int status, const QByteArray &reason) {
+        responded_ = true;
+        writeHeader(status, reason, {{"Content-Type", "text/plain"}}, reason.size());
+        if (!head_) socket_->write(reason);
+        close();
+    }
+
+    // Sends as much of the body as the socket takes without blocking.
+    void resumeBody() {
+        if (streaming_ && !closing_) return resumeGrowing();
+        if (remaining_ <= 0) return;
+        idle_.start(kIdleTimeoutMs);
+#ifdef Q_OS_LINUX
+        // The header must be out before bytes bypass the socket's buffer.
+        if (useSendfile_ && socket_->bytesToWrite() > 0) return;
+        while (useSendfile_ && remaining_ > 0) {
+            off_t offset = off_t(offset_);
+            const ssize_t sent = ::sendfile(int(socket_->socketDescriptor()), file_.handle(), &offset,
+                                            size_t(std::min(remaining_, kSendChunk)));
+            if (sent > 0) {
+                offset_ += sent;
+                remaining_ -= sent;
+                server_->bytesSendfile_ += sent;
+            } else if (sent < 0 && errno == EINTR) {
+                continue;
+            } else if (sent < 0 && errno == EAGAIN) {
+                // QTcpSocket's own write notifier is idle while its buffer is
+                // empty, so this one is the only watcher on the descriptor.
+                if (!writable_) {
+                    writable_ = new QSocketNotifier(socket_->socketDescriptor(), QSocketNotifier::Write, this);
+                    connect(writable_, &QSocketNotifier::activated, this, [this]() {
+                        writable_->setEnabled(false);
+                        resumeBody();
+                    });
+                }
+                writable_->setEnabled(true);
+                return;
+            } else if (sent < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                // Not a file sendfile can map (e.g. some FUSE mounts).
+                useSendfile_ = false;
+                if (!file_.seek(offset_)) return close();
+            } else {
+                return close(); // client gone, or the file shrank
+            }
+        }
+        if (remaining_ == 0) return close();
+#endif
+        while (remaining_ > 0 && socket_->bytesToWrite() < kSendChunk) {
+            const QByteArray chunk = file_.read(std::min(remaining_, kSendChunk));
+            if (chunk.isEmpty()) return close();
+            socket_->write(chunk);
+            offset_ += chunk.size();
+            remaining_ -= chunk.size();
+            server_->bytesCopied_ += chunk.size();
+        }
+        if (remaining_ == 0) close();
+    }
+
+    void close() {
+        remaining_ = 0;
+        closing_ = true;
+        poll_.stop();
+        if (writable_) writable_->setEnabled(false);
+        // Flushes what the socket still buffers before closing.
+        socket_->disconnectFromHost();
+        if (socket_->state() == QAbstractSocket::UnconnectedState) deleteLater();
+    }
+
+    LibraryServer *server_;
+    QTcpSocket *socket_;
+    QSocketNotifier *writable_ = nullptr;
+    QTimer idle_;
+    QTimer poll_; // watches a growing transcoder output
+    QMetaObject::Connection waiting_;
+    QByteArray request_;
+    QFile file_;
+    QString growing_;
+    qint64 finalSize_ = -1; // of growing_, once the job is done
+    qint64 offset_ = 0;
+    qint64 remaining_ = 0;
+    bool responded_ = false;
+    bool head_ = false;
+    bool streaming_ = false;
+    bool closing_ = false;
+#ifdef Q_OS_LINUX
+    bool useSendfile_ = true;
+#endif
+};
+
+LibraryServer::LibraryServer(QObject *parent)
+    : QObject(parent) {
+    connect(&server_, &QTcpServer::newConnection, this, [this]() {
+        while (QTcpSocket *socket = server_.nextPendingConnection()) new Connection(socket, this);
+    });
+}
+
+LibraryServer::~LibraryServer() {
+    // The only children are connections; they must go while the counters
+    // they update still exist.
+    const QObjectList connections = children();
+    qDeleteAll(connections);
+}
+
+quint16 LibraryServer::configuredPort() {
+    bool ok = false;
+    const int port = qEnvironmentVariableIntValue("MUSICPLAYER_HTTP_PORT", &ok);
+    return ok && port > 0 && port <= 65535 ? quint16(port) : 0;
+}
+
+bool LibraryServer::listen(quint16 port) { return server_.listen(QHostAddress::Any, port); }
+
+void LibraryServer::setTracks(const QVector<Track> &tracks) {
+    tracks_ = tracks;
+    trackIndex_.clear();
+    trackIndex_.reserve(tracks_.size());
+    for (int i = 0; i < tracks_.size(); ++i) trackIndex_.insert(tracks_[i].id, i);
+    listing_.clear();
+}
+
+const QByteArray &LibraryServer::listing() {
+    if (!listing_.isEmpty()) return listing_;
+    QJsonArray array;
+    for (const Track &track : std::as_const(tracks_)) {
+        array.append(QJsonObject{{"id", track.id},
+                                 {"title", QFileInfo(track.path).completeBaseName()},
+                                 {"artist", track.artist},
+                                 {"album", track.album},
+                                 {"url", QString("/tracks/%1").arg(track.id)}});
+    }
+    QJsonArray profiles;
+    for (const char *name : {"mp3", "opus"}) {
+        Transcoder::Profile profile;
+        if (Transcoder::parseProfile(QLatin1String(name), &profile) && Transcoder::isAvailable(profile)) profiles.append(name);
+    }
+    listing_ = QJsonDocument(QJsonObject{{"profiles", profiles}, {"tracks", array}}).toJson(QJsonDocument::Compact);
+    return listing_;
+}
+
+QString LibraryServer::report() const {
+    QStringList lines;
+    lines << "[HTTP server]";
+    if (!server_.isListening()) {
+        lines << "Not listening";
+        return lines.join('\n');
+    }
+    lines << QString("Port: %1, tracks: %2, clients: %3, requests: %4")
+                 .arg(server_.serverPort()).arg(tracks_.size()).arg(clients_).arg(requests_);
+    lines << QString("Sent: %1 MiB via sendfile, %2 MiB copied")
+                 .arg(bytesSendfile_ / (1024.0 * 1024.0), 0, 'f', 1)
+                 .arg(bytesCopied_ / (1024.0 * 1024.0), 0, 'f', 1);
+    return lines.join('\n') + "\n\n" + transcoder_.report();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Transcoder.h"
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+#include <QVector>
+
+// Embedded HTTP server that lets other devices browse and stream the library.
+//
+//   GET /tracks       JSON listing (id, title, artist, album, url)
+//   GET /tracks/<id>  the audio file, with single-range Range support
+//   GET /tracks/<id>?profile=mp3|opus
+//                     the file transcoded for the profile: from the cache,
+//                     else streamed as the transcoder writes it (no length,
+//                     no ranges past the start; those wait for the cache).
+//                     The original when transcoding fails before any output
+//
+// Every client is served from the owner's event loop. On Linux file bodies go
+// out with sendfile(2) straight from the page cache to the socket; elsewhere
+// (or when sendfile refuses the file) they are copied in chunks. Only tracks
+// handed over in setTracks() can be fetched.
+class LibraryServer final : public QObject {
+    Q_OBJECT
+
+public:
+    struct Track {
+        int id = -1;
+        QString path;
+        QString artist;
+        QString album;
+    };
+
+    explicit LibraryServer(QObject *parent = nullptr);
+    ~LibraryServer() override;
+
+    // Port from MUSICPLAYER_HTTP_PORT; 0 when serving is off.
+    static quint16 configuredPort();
+
+    bool listen(quint16 port);
+    void setTracks(const QVector<Track> &tracks);
+    QString report() const;
+
+private:
+    class Connection;
+
+    const QByteArray &listing();
+
+    QTcpServer server_;
+    Transcoder transcoder_;
+    QVector<Track> tracks_;
+    QHash<int, int> trackIndex_; // track ID -> position in tracks_
+    QByteArray listing_; // built on first request after a change
+    int clients_ = 0;
+    qint64 requests_ = 0;
+    qint64 bytesSendfile_ = 0;
+    qint64 bytesCopied_ = 0;
+};
@@ -0,0 +1,113 @@
+#include "LibrarySnapshot.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <climits>
+#include <cstring>
+
+namespace {
+constexpr quint32 kSnapshotMagic = 0x534C424D; // "MBLS"
+constexpr quint32 kSnapshotVersion = 1;
+constexpr int kTrackFields = 3;
+
+// Native byte order throughout; the byte-order mark rejects foreign files.
+struct Header {
+    quint32 magic;
+    quint32 version;
+    quint32 byteOrder;
+    quint32 rootCount;
+    quint32 trackCount;
+    quint32 reserved;
+    quint64 stringUnits;
+};
+constexpr quint32 kByteOrderMark = 0x01020304;
+} // namespace
+
+QString LibrarySnapshot::sharedPath() { return qEnvironmentVariable("MUSICPLAYER_SHARED_LIBRARY"); }
+
+bool LibrarySnapshot::write(const QString &filePath, const QStringList &roots, const QVector<Track> &tracks) {
+    QVector<Slice> slices;
+    slices.reserve(roots.size() + tracks.size() * kTrackFields);
+    QString strings;
+    const auto append = [&](const QString &text) {
+        slices.append({quint32(strings.size()), quint32(text.size())});
+        strings += text;
+    };
+    for (const QString &root : roots) append(root);
+    for (const Track &track : tracks) {
+        append(track.path);
+        append(track.artist);
+        append(track.album);
+    }
+
+    const Header header{kSnapshotMagic, kSnapshotVersion, kByteOrderMark, quint32(roots.size()), quint32(tracks.size()), 0,
+                        quint64(strings.size())};
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(slices.constData()), qint64(slices.size()) * qint64(sizeof(Slice)));
+    file.write(reinterpret_cast<const char *>(strings.utf16()), qint64(strings.size()) * 2);
+    return file.commit();
+}
+
+bool LibrarySnapshot::open(const QString &filePath) {
+    close();
+    file_.setFileName(filePath);
+    if (!file_.open(QIODevice::ReadOnly)) return false;
+    const qint64 size = file_.size();
+    const uchar *data = size >= qint64(sizeof(Header)) ? file_.map(0, size) : nullptr;
+    if (!data) {
+        close();
+        return false;
+    }
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    const quint64 sliceCount = quint64(header.rootCount) + quint64(header.trackCount) * kTrackFields;
+    const quint64 expected = sizeof(Header) + sliceCount * sizeof(Slice) + header.stringUnits * 2;
+    if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion || header.byteOrder != kByteOrderMark
+        || header.trackCount > quint32(INT_MAX / kTrackFields) || header.rootCount > quint32(INT_MAX)
+        || quint64(size) != expected) {
+        close();
+        return false;
+    }
+    // The header is 32 bytes and slices 8, so every table stays aligned.
+    roots_ = reinterpret_cast<const Slice *>(data + sizeof(Header));
+    tracks_ = roots_ + header.rootCount;
+    strings_ = reinterpret_cast<const char16_t *>(tracks_ + quint64(header.trackCount) * kTrackFields);
+    stringUnits_ = header.stringUnits;
+    rootCount_ = int(header.rootCount);
+    trackCount_ = int(header.trackCount);
+    return true;
+}
+
+void LibrarySnapshot::close() {
+    file_.close(); // also unmaps
+    roots_ = nullptr;
+    tracks_ = nullptr;
+    strings_ = nullptr;
+    stringUnits_ = 0;
+    rootCount_ = 0;
+    trackCount_ = 0;
+}
+
+QStringList LibrarySnapshot::roots() const {
+    QStringList paths;
+    paths.reserve(rootCount_);
+    for (int i = 0; i < rootCount_; ++i) paths.append(stringAt(roots_[i]));
+    return paths;
+}
+
+LibrarySnapshot::Track LibrarySnapshot::track(int index) const {
+    const Slice *fields = tracks_ + qsizetype(index) * kTrackFields;
+    return {stringAt(fields[0]), stringAt(fields[1]), stringAt(fields[2])};
+}
+
+QString LibrarySnapshot::stringAt(const Slice &slice) const {
+    // Slices are not trusted: a damaged file yields empty strings, not reads
+    // past the mapping.
+    if (quint64(slice.offset) + slice.length > stringUnits_) return {};
+    return QString(reinterpret_cast<const QChar *>(strings_ + slice.offset), qsizetype(slice.length));
+}
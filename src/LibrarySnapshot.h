@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Read-only image of a library (roots and tracks with their grouping tags)
+// that several players can share, e.g. one per user on a kiosk.
+//
+// The file is a fixed-layout table of UTF-16 string slices that readers map
+// instead of parsing, so a player loads it without walking or probing the
+// music folders. Writers replace it atomically; players that have it mapped
+// keep reading the version they opened.
+class LibrarySnapshot final {
+public:
+    struct Track {
+        QString path;
+        QString artist;
+        QString album;
+    };
+
+    // The shared file, from MUSICPLAYER_SHARED_LIBRARY; empty when sharing is off.
+    static QString sharedPath();
+    static bool write(const QString &filePath, const QStringList &roots, const QVector<Track> &tracks);
+
+    bool open(const QString &filePath);
+    void close();
+
+    QStringList roots() const;
+    int trackCount() const { return trackCount_; }
+    Track track(int index) const;
+
+private:
+    struct Slice {
+        quint32 offset; // in UTF-16 units from the start of the string area
+        quint32 length;
+    };
+
+    QString stringAt(const Slice &slice) const;
+
+    QFile file_;
+    const Slice *roots_ = nullptr;
+    const Slice *tracks_ = nullptr; // path, artist, album per track
+    const char16_t *strings_ = nullptr;
+    quint64 stringUnits_ = 0;
+    int rootCount_ = 0;
+    int trackCount_ = 0;
+};
@@ -1,20 +1,44 @@
 #pragma once
 
+#include "CueSheet.h"
+#include "DirectoryTable.h"
+#include "LibraryExport.h"
+#include "LibraryIndex.h"
+#include "MetadataCache.h"
+#include "Theme.h"
+
+#include <QHash>
 #include <QMainWindow>
 #include <QMediaPlayer>
+#include <QPointer>
 #include <QSet>
+#include <QStringList>
 #include <QVector>
 
-class QAudioOutput;
+class AudioEngine;
+class FingerprintJob;
+class LibraryServer;
+class MemoryBudget;
+class QAbstractItemModel;
+class QAbstractListModel;
+class QDialog;
+class QDragEnterEvent;
+class QDropEvent;
 class QLineEdit;
+class QMenu;
 class QListView;
 class QPushButton;
 class QSortFilterProxyModel;
+class QStackedWidget;
+class QStandardItem;
 class QStandardItemModel;
-class QMediaPlayer;
+class QTimer;
+class ThumbnailCache;
+struct ScannedFile;
 class QLabel;
 class QSlider;
 class QToolButton;
+class QTreeView;
 
 class MainWindow final : public QMainWindow {
     Q_OBJECT
@@ -23,6 +47,14 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow() override;
 
+    // Imports files and folders (from the command line, a drop or another
+    // launch) and plays the first one.
+    void openPaths(const QStringList &paths);
+
+protected:
+    void dragEnterEvent(QDragEnterEvent *event) override;
+    void dropEvent(QDropEvent *event) override;
+
 private slots:
     void addFolder();
     void playSelected();
@@ -39,26 +71,87 @@ private slots:
     void handleMediaStatus(QMediaPlayer::MediaStatus status);
     void toggleShuffle();
     void cycleRepeat();
+    void cycleAbLoop();
+    void addCuePoint();
+    void jumpToCuePoint(int index);
     void updateVolume(int value);
+    void showDiagnostics();
+    void findDuplicates();
+    void showAllTracks();
+    void showArtists();
+    void showAlbums();
+    void openArtist(const QModelIndex &index);
+    void openAlbum(const QModelIndex &index);
+    void openFolder(const QModelIndex &index);
+    void showFolderMenu(const QPoint &pos);
+    void updateVisibleThumbnails();
+    void toggleTheme();
+    void openStream();
 
 private:
     void setupUi();
     void scanFolder(const QString &path);
-    void addTrack(const QString &filePath);
+    // Incremental walk of roots on the thread pool; new files are imported
+    // back on this thread.
+    void rescanInBackground(const QStringList &roots);
+    void importScan(QVector<ScannedFile> &files, const QStringList &replaced);
+    void importFiles(QVector<ScannedFile> &files);
+    void openPath(const QString &path, bool play);
+    // Rows of added tracks reach the model in syncLibraryViews(), which every
+    // import calls last.
+    bool addTrack(const QString &filePath, const QString &artist, const QString &album);
+    void reserveTracks(int count);
+    void relinkTracks(const QHash<QString, QString> &moved);
+    void followMovedPaths(const QHash<QString, QString> &moved);
+    // Drop or move a folder of the library in place, touching only its tracks.
+    void removeLibraryFolder(int folderId);
+    // Drops the rows and index entries of tracks already gone from directories_.
+    void removeTrackItems(const QVector<int> &sortedTrackIds);
+    bool relocateLibraryRoot(int rootId, const QString &newPath);
+    void syncLibraryViews();
+    // Library image shared with other players (LibrarySnapshot::sharedPath());
+    // publishing also refreshes what the HTTP server offers.
+    bool loadSharedLibrary();
+    void publishLibrary(bool writeSnapshot = true);
     void playTrack(const QString &filePath, bool recordHistory = true);
     void playIndex(const QModelIndex &proxyIndex);
     void updateCounts();
+    int trackIdOf(const QString &filePath) const;
+    // The CUE track a library path names, reading its sheet once; null for
+    // ordinary files.
+    const CueTrack *findCueTrack(const QString &path, QString *audioPath = nullptr);
+    // The track after path in its CUE sheet when that one is in the library.
+    QString nextCueTrackPath(const QString &path);
+    QString trackTitle(const QString &path);
     QString formatTime(qint64 ms) const;
+    void updateLoopButton();
+    void populateCueMenu(QMenu *menu);
+    void showDuplicates(const QStringList &paths, const QVector<QVector<int>> &groups, int total);
+    QString diagnosticsReport() const;
+    LibraryColumns libraryColumns() const;
 
     QLineEdit *searchEdit_ = nullptr;
+    QLabel *listHeader_ = nullptr;
+    QStackedWidget *viewStack_ = nullptr;
     QListView *listView_ = nullptr;
+    QListView *artistView_ = nullptr;
+    QListView *albumView_ = nullptr;
+    QTreeView *folderView_ = nullptr;
+    QToolButton *allTracksButton_ = nullptr;
+    QToolButton *artistsButton_ = nullptr;
+    QToolButton *albumsButton_ = nullptr;
     QPushButton *playPauseButton_ = nullptr;
     QPushButton *stopButton_ = nullptr;
     QToolButton *prevButton_ = nullptr;
     QToolButton *nextButton_ = nullptr;
     QToolButton *shuffleButton_ = nullptr;
     QToolButton *repeatButton_ = nullptr;
+    QToolButton *speedButton_ = nullptr;
+    QToolButton *loopButton_ = nullptr;
+    QToolButton *cueButton_ = nullptr;
     QToolButton *addFolderButton_ = nullptr;
+    QToolButton *duplicatesButton_ = nullptr;
+    QToolButton *themeButton_ = nullptr;
     QLabel *coverLabel_ = nullptr;
     QLabel *nowPlayingTitleLabel_ = nullptr;
     QLabel *nowPlayingPathLabel_ = nullptr;
@@ -66,17 +159,50 @@ private:
     QSlider *seekSlider_ = nullptr;
     QSlider *volumeSlider_ = nullptr;
     QLabel *countLabel_ = nullptr;
+    QPointer<QDialog> diagnosticsDialog_;
+    QString paintBenchmark_;
+    QString libraryStats_;
+    QString lastScan_;
+    QString lastWalk_; // set by scanFolder() for the import that follows
+    Theme::Kind theme_ = Theme::Kind::Light;
 
     QStandardItemModel *model_ = nullptr;
     QSortFilterProxyModel *filter_ = nullptr;
+    LibraryIndex libraryIndex_;
+    QAbstractListModel *artistModel_ = nullptr;
+    QAbstractListModel *albumModel_ = nullptr;
+    QSortFilterProxyModel *artistFilter_ = nullptr;
+    QSortFilterProxyModel *albumFilter_ = nullptr;
+    DirectoryTable directories_;
+    QAbstractItemModel *folderModel_ = nullptr;
+    QSortFilterProxyModel *folderFilter_ = nullptr;
+    int nextTrackId_ = 0;
+    ThumbnailCache *thumbnails_ = nullptr;
+    QTimer *thumbnailTimer_ = nullptr;
+    QTimer *cacheSaveTimer_ = nullptr; // saves cue and loop edits
+    int lastAlbumScroll_ = 0;
 
-    QMediaPlayer *player_ = nullptr;
-    QAudioOutput *audioOutput_ = nullptr;
+    AudioEngine *player_ = nullptr;
+    MetadataCache metadataCache_;
+    FingerprintJob *fingerprintJob_ = nullptr;
+    MemoryBudget *memoryBudget_ = nullptr;
+    LibraryServer *server_ = nullptr;
     bool isPlaying_ = false;
     qint64 durationMs_ = 0;
     bool shuffleEnabled_ = false;
     int repeatMode_ = 0;
+    // A-B loop of the current track: A alone while B is not set yet.
+    qint64 loopStartUs_ = -1;
+    qint64 loopEndUs_ = -1;
+    QVector<qint64> cuePointsUs_;
+    // Part of the source file the current track covers (CUE tracks).
+    qint64 trackStartUs_ = 0;
+    qint64 trackEndUs_ = -1;
+    bool crossingTrackEnd_ = false;
+    QHash<QString, CueSheet> cueSheets_;
     QString currentFilePath_;
     QVector<QString> playHistory_;
     QSet<QString> trackSet_;
+    QVector<QStandardItem *> trackItems_; // by track ID, null once removed
+    QList<QStandardItem *> pendingRows_;
 };
@@ -0,0 +1,98 @@
+#include "MemoryBudget.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+// Below this share of MemTotal the system counts as under pressure.
+constexpr int kLowMemoryPercent = 10;
+
+QString formatMiB(qint64 bytes) { return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MiB"; }
+} // namespace
+
+MemoryBudget::MemoryBudget(QObject *parent) : QObject(parent) {
+    bool ok = false;
+    const int mib = qEnvironmentVariableIntValue("MUSICPLAYER_MEMORY_BUDGET_MB", &ok);
+    if (ok && mib > 0) budget_ = qint64(mib) << 20;
+    timer_ = new QTimer(this);
+    timer_->setInterval(kCheckIntervalMs);
+    connect(timer_, &QTimer::timeout, this, &MemoryBudget::check);
+    timer_->start();
+}
+
+void MemoryBudget::addCache(Cache cache) {
+    caches_.append(std::move(cache));
+    usage_.append(Usage());
+}
+
+void MemoryBudget::check() {
+    const bool pressure = systemUnderPressure();
+    if (pressure && !underPressure_) ++pressureEvents_;
+    underPressure_ = pressure;
+    qint64 total = 0;
+    for (int i = 0; i < caches_.size(); ++i) {
+        usage_[i].bytes = caches_[i].bytes();
+        if (caches_[i].trimTo) total += usage_[i].bytes;
+    }
+    const qint64 limit = underPressure_ ? budget_ / 2 : budget_;
+    if (total > limit) trim(total - limit);
+}
+
+void MemoryBudget::trim(qint64 excess) {
+    ++trims_;
+    qreal weights = 0;
+    for (int i = 0; i < caches_.size(); ++i) {
+        if (caches_[i].trimTo) weights += usage_[i].bytes / caches_[i].reloadCost;
+    }
+    if (weights <= 0) return;
+    for (int i = 0; i < caches_.size(); ++i) {
+        const Cache &cache = caches_[i];
+        if (!cache.trimTo || usage_[i].bytes == 0) continue;
+        const qreal share = usage_[i].bytes / cache.reloadCost / weights;
+        const qint64 target = std::max<qint64>(0, usage_[i].bytes - qint64(excess * share + 0.5));
+        cache.trimTo(target);
+        const qint64 bytes = cache.bytes();
+        usage_[i].evicted += std::max<qint64>(0, usage_[i].bytes - bytes);
+        usage_[i].bytes = bytes;
+    }
+}
+
+bool MemoryBudget::systemUnderPressure() const {
+#ifdef Q_OS_LINUX
+    QFile file("/proc/meminfo");
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    qint64 totalKiB = 0;
+    qint64 availableKiB = -1;
+    while (!file.atEnd() && (totalKiB == 0 || availableKiB < 0)) {
+        const QByteArray line = file.readLine();
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.size() < 2) continue;
+        if (fields[0] == "MemTotal:") totalKiB = fields[1].toLongLong();
+        else if (fields[0] == "MemAvailable:") availableKiB = fields[1].toLongLong();
+    }
+    return totalKiB > 0 && availableKiB >= 0 && availableKiB * 100 < totalKiB * kLowMemoryPercent;
+#else
+    return false;
+#endif
+}
+
+QString MemoryBudget::report() const {
+    QStringList lines;
+    qint64 total = 0;
+    for (int i = 0; i < caches_.size(); ++i) {
+        if (caches_[i].trimTo) total += usage_[i].bytes;
+    }
+    lines << "[Memory]";
+    lines << QString("Caches: %1 of %2%3, trims: %4, pressure events: %5")
+                 .arg(formatMiB(total)).arg(formatMiB(budget_))
+                 .arg(underPressure_ ? " (halved: system memory low)" : "").arg(trims_).arg(pressureEvents_);
+    for (int i = 0; i < caches_.size(); ++i) {
+        lines << QString("%1: %2%3").arg(caches_[i].name).arg(formatMiB(usage_[i].bytes))
+                     .arg(caches_[i].trimTo ? QString(", evicted %1").arg(formatMiB(usage_[i].evicted))
+                                            : QString(" (pinned)"));
+    }
+    return lines.join('\n');
+}
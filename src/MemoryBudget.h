@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+class QTimer;
+
+// Shared memory budget for the in-memory caches.
+//
+// Caches register how to measure and how to shrink themselves; a timer checks
+// their total against the budget and, when it is exceeded, splits the excess
+// across caches by footprint divided by reload cost, so large caches that are
+// cheap to refill give up the most. Each cache evicts its own least recently
+// used entries; for decoded audio those are chunks played long ago, and what
+// they cannot cover comes out of the audio decoded ahead of playback. Pinned
+// caches are reported but neither counted nor trimmed. On Linux, low
+// MemAvailable halves the budget until memory recovers.
+class MemoryBudget final : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 kDefaultBudgetBytes = qint64(128) << 20;
+    static constexpr int kCheckIntervalMs = 2000;
+
+    struct Cache {
+        QString name;
+        // Relative effort of rebuilding a byte; 1 is reloading from disk.
+        qreal reloadCost = 1.0;
+        std::function<qint64()> bytes;
+        // Evicts least recently used entries down to at most the given size;
+        // empty for pinned caches.
+        std::function<void(qint64)> trimTo;
+    };
+
+    // MUSICPLAYER_MEMORY_BUDGET_MB overrides the default budget.
+    explicit MemoryBudget(QObject *parent = nullptr);
+
+    void addCache(Cache cache);
+    qint64 budget() const { return budget_; }
+    // Trims right away when the evictable caches exceed the current limit.
+    void check();
+    QString report() const;
+
+private:
+    struct Usage {
+        qint64 bytes = 0;
+        qint64 evicted = 0;
+    };
+
+    bool systemUnderPressure() const;
+    void trim(qint64 limit);
+
+    QVector<Cache> caches_;
+    QVector<Usage> usage_;
+    QTimer *timer_ = nullptr;
+    qint64 budget_ = kDefaultBudgetBytes;
+    bool underPressure_ = false;
+    int trims_ = 0;
+    int pressureEvents_ = 0;
+};
@@ -0,0 +1,168 @@
+#include "MetadataCache.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+constexpr quint32 kCacheMagic = 0x4D424D43; // "MBMC"
+constexpr quint32 kCacheVersion = 1;
+} // namespace
+
+QDataStream &operator<<(QDataStream &out, const TrackMetadata &metadata) {
+    return out << metadata.size << metadata.modifiedMs << metadata.contentHash << metadata.fingerprint
+               << metadata.artist << metadata.album << metadata.playCount << metadata.lastPlayedMs << metadata.durationMs
+               << metadata.cuePointsUs << metadata.loopStartUs << metadata.loopEndUs;
+}
+
+QDataStream &operator>>(QDataStream &in, TrackMetadata &metadata) {
+    return in >> metadata.size >> metadata.modifiedMs >> metadata.contentHash >> metadata.fingerprint
+              >> metadata.artist >> metadata.album >> metadata.playCount >> metadata.lastPlayedMs >> metadata.durationMs
+              >> metadata.cuePointsUs >> metadata.loopStartUs >> metadata.loopEndUs;
+}
+
+QString MetadataCache::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/metadata.cache";
+}
+
+bool MetadataCache::load(const QString &path) {
+    path_ = path;
+    entries_.clear();
+    byHash_.clear();
+    dirty_ = false;
+    QFile file(path_);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+    // An unknown format is simply rebuilt; the cache holds nothing irreplaceable.
+    if (magic != kCacheMagic || version != kCacheVersion) return false;
+    in >> entries_;
+    if (in.status() != QDataStream::Ok) {
+        entries_.clear();
+        return false;
+    }
+    rebuildHashIndex();
+    return true;
+}
+
+bool MetadataCache::save() {
+    if (!dirty_ || path_.isEmpty()) return true;
+    QDir().mkpath(QFileInfo(path_).absolutePath());
+    QSaveFile file(path_);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kCacheMagic << kCacheVersion << entries_;
+    if (!file.commit()) return false;
+    dirty_ = false;
+    return true;
+}
+
+const TrackMetadata *MetadataCache::find(const QString &filePath) const {
+    const auto it = entries_.constFind(filePath);
+    return it == entries_.cend() ? nullptr : &it.value();
+}
+
+const TrackMetadata *MetadataCache::findFresh(const QString &filePath, qint64 size, qint64 modifiedMs) const {
+    const TrackMetadata *metadata = find(filePath);
+    if (!metadata || metadata->size != size || metadata->modifiedMs != modifiedMs) return nullptr;
+    return metadata;
+}
+
+TrackMetadata &MetadataCache::upsert(const QString &filePath) {
+    dirty_ = true;
+    return entries_[filePath];
+}
+
+void MetadataCache::rename(const QString &fromPath, const QString &toPath) {
+    const auto it = entries_.constFind(fromPath);
+    if (it == entries_.cend() || fromPath == toPath) return;
+    const TrackMetadata metadata = it.value();
+    entries_.erase(it);
+    if (metadata.contentHash != 0) {
+        byHash_.remove(metadata.contentHash, fromPath);
+        byHash_.insert(metadata.contentHash, toPath);
+    }
+    entries_.insert(toPath, metadata);
+    dirty_ = true;
+}
+
+QString MetadataCache::attach(const QString &filePath, qint64 size, qint64 modifiedMs, quint64 contentHash) {
+    auto it = entries_.find(filePath);
+    if (it == entries_.end() && contentHash != 0) {
+        for (auto candidate = byHash_.constFind(contentHash); candidate != byHash_.cend() && candidate.key() == contentHash; ++candidate) {
+            const QString previous = candidate.value();
+            if (previous == filePath || QFileInfo::exists(previous)) continue;
+            TrackMetadata metadata = entries_.take(previous);
+            byHash_.remove(contentHash, previous);
+            metadata.size = size;
+            metadata.modifiedMs = modifiedMs;
+            entries_.insert(filePath, metadata);
+            byHash_.insert(contentHash, filePath);
+            dirty_ = true;
+            return previous;
+        }
+    }
+    if (it == entries_.end()) it = entries_.insert(filePath, TrackMetadata());
+
+    TrackMetadata &metadata = it.value();
+    if (metadata.size == size && metadata.modifiedMs == modifiedMs && metadata.contentHash == contentHash) return {};
+    if (contentHash == 0 || metadata.contentHash != contentHash || metadata.size != size) {
+        // The audio changed: derived data is stale, listening history is not.
+        if (metadata.contentHash != 0) byHash_.remove(metadata.contentHash, filePath);
+        TrackMetadata fresh;
+        fresh.playCount = metadata.playCount;
+        fresh.lastPlayedMs = metadata.lastPlayedMs;
+        fresh.contentHash = contentHash;
+        metadata = fresh;
+        if (contentHash != 0) byHash_.insert(contentHash, filePath);
+    }
+    // Same content with a new mtime (touched, copied back) keeps everything.
+    metadata.size = size;
+    metadata.modifiedMs = modifiedMs;
+    dirty_ = true;
+    return {};
+}
+
+void MetadataCache::notePlayed(const QString &filePath, qint64 playedAtMs) {
+    const auto it = entries_.find(filePath);
+    if (it == entries_.end()) return;
+    ++it->playCount;
+    it->lastPlayedMs = playedAtMs;
+    dirty_ = true;
+}
+
+void MetadataCache::noteDuration(const QString &filePath, qint64 durationMs) {
+    const auto it = entries_.find(filePath);
+    if (it == entries_.end() || it->durationMs == durationMs) return;
+    it->durationMs = durationMs;
+    dirty_ = true;
+}
+
+void MetadataCache::noteCuePoints(const QString &filePath, const QVector<qint64> &cuePointsUs) {
+    const auto it = entries_.find(filePath);
+    if (it == entries_.end() || it->cuePointsUs == cuePointsUs) return;
+    it->cuePointsUs = cuePointsUs;
+    dirty_ = true;
+}
+
+void MetadataCache::noteLoop(const QString &filePath, qint64 startUs, qint64 endUs) {
+    const auto it = entries_.find(filePath);
+    if (it == entries_.end() || (it->loopStartUs == startUs && it->loopEndUs == endUs)) return;
+    it->loopStartUs = startUs;
+    it->loopEndUs = endUs;
+    dirty_ = true;
+}
+
+void MetadataCache::rebuildHashIndex() {
+    byHash_.clear();
+    for (auto it = entries_.cbegin(); it != entries_.cend(); ++it) {
+        if (it->contentHash != 0) byHash_.insert(it->contentHash, it.key());
+    }
+}
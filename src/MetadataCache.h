@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QHash>
+#include <QMultiHash>
+#include <QString>
+#include <QVector>
+
+class QDataStream;
+
+// Per-file data that is expensive to compute (decoding, hashing). Entries are
+// only trusted while the file's size and modification time still match, or
+// while its content hash does (see MetadataCache::attach()).
+struct TrackMetadata {
+    qint64 size = 0;
+    qint64 modifiedMs = 0;
+    quint64 contentHash = 0;
+    QVector<quint32> fingerprint;
+    QString artist;
+    QString album;
+    int playCount = 0;
+    qint64 lastPlayedMs = 0;
+    qint64 durationMs = 0; // 0 until known
+    QVector<qint64> cuePointsUs; // ascending
+    qint64 loopStartUs = -1;     // A-B loop, -1 when none
+    qint64 loopEndUs = -1;
+};
+
+QDataStream &operator<<(QDataStream &out, const TrackMetadata &metadata);
+QDataStream &operator>>(QDataStream &in, TrackMetadata &metadata);
+
+// On-disk cache of TrackMetadata keyed by absolute file path, with a secondary
+// index by content hash so records can follow files that were moved.
+class MetadataCache final {
+public:
+    static QString defaultPath();
+
+    bool load(const QString &path = defaultPath());
+    bool save();
+
+    const TrackMetadata *find(const QString &filePath) const;
+    // Returns the entry if it is still valid for a file of this size and mtime.
+    const TrackMetadata *findFresh(const QString &filePath, qint64 size, qint64 modifiedMs) const;
+    TrackMetadata &upsert(const QString &filePath);
+    // Moves a record to a new path as is (the library root was relocated).
+    void rename(const QString &fromPath, const QString &toPath);
+
+    // Records the scanned version of a file. An unknown path whose content hash
+    // matches a record for a file that no longer exists takes over that record;
+    // the old path is returned so callers can re-link their own references.
+    QString attach(const QString &filePath, qint64 size, qint64 modifiedMs, quint64 contentHash);
+    void notePlayed(const QString &filePath, qint64 playedAtMs);
+    void noteDuration(const QString &filePath, qint64 durationMs);
+    void noteCuePoints(const QString &filePath, const QVector<qint64> &cuePointsUs);
+    void noteLoop(const QString &filePath, qint64 startUs, qint64 endUs);
+
+    int size() const { return entries_.size(); }
+    bool isDirty() const { return dirty_; }
+
+private:
+    void rebuildHashIndex();
+
+    QHash<QString, TrackMetadata> entries_;
+    QMultiHash<quint64, QString> byHash_;
+    QString path_;
+    bool dirty_ = false;
+};
@@ -0,0 +1,83 @@
+#include "PcmBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+PcmBuffer::PcmBuffer()
+    : chunks_(kMaxChunks) {}
+
+void PcmBuffer::reset(int sampleRate, int channels) {
+    for (qint64 i = freedChunks_; i < allocatedChunks_; ++i) chunks_[size_t(i % kMaxChunks)].reset();
+    allocatedChunks_ = 0;
+    releasedChunks_ = 0;
+    freedChunks_ = 0;
+    firstFrame_.store(0, std::memory_order_release);
+    frames_.store(0, std::memory_order_release);
+    complete_.store(false, std::memory_order_release);
+    sampleRate_ = sampleRate;
+    channels_ = channels;
+}
+
+bool PcmBuffer::append(const qint16 *samples, qint64 frames) {
+    qint64 written = frames_.load(std::memory_order_relaxed);
+    while (frames > 0) {
+        const qint64 index = written / kChunkFrames;
+        if (index >= allocatedChunks_) {
+            // The slot is reused only after its previous chunk was freed.
+            if (index - freedChunks_ >= kMaxChunks) return false;
+            chunks_[size_t(index % kMaxChunks)].reset(new qint16[kChunkFrames * channels_]);
+            allocatedChunks_ = index + 1;
+        }
+        const qint64 offset = written % kChunkFrames;
+        const qint64 count = std::min(frames, kChunkFrames - offset);
+        std::memcpy(chunk(index) + offset * channels_, samples, count * channels_ * sizeof(qint16));
+        samples += count * channels_;
+        frames -= count;
+        written += count;
+        // Publish after the copy so readers never see unwritten samples.
+        frames_.store(written, std::memory_order_release);
+    }
+    return true;
+}
+
+qint64 PcmBuffer::read(qint64 frame, qint16 *out, qint64 frames) const {
+    // Registered before firstFrame_ is checked: releaseBefore() publishes
+    // firstFrame_ before it counts readers, so either it sees this read and
+    // keeps the chunks, or this read sees the new first frame.
+    readers_.fetch_add(1, std::memory_order_seq_cst);
+    const qint64 available = frames_.load(std::memory_order_acquire);
+    if (frame < firstFrame_.load(std::memory_order_seq_cst) || frame >= available) {
+        readers_.fetch_sub(1, std::memory_order_release);
+        return 0;
+    }
+    frames = std::min(frames, available - frame);
+    qint64 done = 0;
+    while (done < frames) {
+        const qint64 position = frame + done;
+        const qint64 offset = position % kChunkFrames;
+        const qint64 count = std::min(frames - done, kChunkFrames - offset);
+        std::memcpy(out + done * channels_, chunk(position / kChunkFrames) + offset * channels_,
+                    count * channels_ * sizeof(qint16));
+        done += count;
+    }
+    readers_.fetch_sub(1, std::memory_order_release);
+    return done;
+}
+
+void PcmBuffer::releaseBefore(qint64 frame) {
+    const qint64 end = std::min(frame / kChunkFrames, allocatedChunks_);
+    if (end > releasedChunks_) {
+        releasedChunks_ = end;
+        firstFrame_.store(end * kChunkFrames, std::memory_order_seq_cst);
+    }
+    reclaim();
+}
+
+void PcmBuffer::reclaim() {
+    if (freedChunks_ == releasedChunks_ || readers_.load(std::memory_order_seq_cst) != 0) return;
+    for (; freedChunks_ < releasedChunks_; ++freedChunks_) chunks_[size_t(freedChunks_ % kMaxChunks)].reset();
+}
+
+qint64 PcmBuffer::memoryBytes() const {
+    return (allocatedChunks_ - freedChunks_) * kChunkFrames * channels_ * qint64(sizeof(qint16));
+}
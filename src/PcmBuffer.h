@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Decoded interleaved 16-bit PCM for one track.
+//
+// Storage is a fixed ring of fixed-size chunks, so appending never moves
+// samples that a reader may be copying, and chunks freed before the played
+// position are reused for audio further on. One thread appends and releases;
+// any number of threads (including the audio render thread) may read
+// concurrently without locking. reset() must only be called while no reader
+// is active.
+class PcmBuffer final {
+public:
+    static constexpr qint64 kChunkFrames = qint64(1) << 16;
+    static constexpr int kMaxChunks = 8192;
+
+    PcmBuffer();
+
+    void reset(int sampleRate = 0, int channels = 0);
+    bool isConfigured() const { return sampleRate_ > 0 && channels_ > 0; }
+    int sampleRate() const { return sampleRate_; }
+    int channels() const { return channels_; }
+
+    // Appends whole frames; returns false once kMaxChunks chunks are held.
+    bool append(const qint16 *samples, qint64 frames);
+    void markComplete() { complete_.store(true, std::memory_order_release); }
+    bool isComplete() const { return complete_.load(std::memory_order_acquire); }
+
+    qint64 availableFrames() const { return frames_.load(std::memory_order_acquire); }
+    // First frame that has not been released; reads before it return nothing.
+    qint64 firstFrame() const { return firstFrame_.load(std::memory_order_acquire); }
+    qint64 read(qint64 frame, qint16 *out, qint64 frames) const;
+    // Releases whole chunks before frame: played audio of live streams, and of
+    // files when the memory budget runs short. Chunks a reader may still be
+    // copying from are retired and freed by a later releaseBefore() or
+    // reclaim() that finds no read in progress.
+    void releaseBefore(qint64 frame);
+    void reclaim();
+
+    qint64 framesToMs(qint64 frames) const { return sampleRate_ > 0 ? frames * 1000 / sampleRate_ : 0; }
+    qint64 msToFrames(qint64 ms) const { return ms * sampleRate_ / 1000; }
+    // Microseconds resolve single frames at any rate; rounded to the nearest.
+    qint64 framesToUs(qint64 frames) const { return sampleRate_ > 0 ? frames * 1000000 / sampleRate_ : 0; }
+    qint64 usToFrames(qint64 us) const { return (us * sampleRate_ + 500000) / 1000000; }
+    qint64 memoryBytes() const;
+
+private:
+    qint16 *chunk(qint64 index) const { return chunks_[size_t(index % kMaxChunks)].get(); }
+
+    std::vector<std::unique_ptr<qint16[]>> chunks_;
+    std::atomic<qint64> frames_{0};
+    std::atomic<qint64> firstFrame_{0};
+    std::atomic<bool> complete_{false};
+    // Reads in progress; a chunk is freed only once none could still see it.
+    mutable std::atomic<int> readers_{0};
+    int sampleRate_ = 0;
+    int channels_ = 0;
+    // Chunk indices, counted from the start of the track.
+    qint64 allocatedChunks_ = 0;
+    qint64 releasedChunks_ = 0;
+    qint64 freedChunks_ = 0;
+};
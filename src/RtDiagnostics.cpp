@@ -0,0 +1,227 @@
+#include "RtDiagnostics.h"
+
+#include <QStringList>
+
+#ifdef MUSICPLAYER_RT_CHECKS
+#if defined(__GLIBC__)
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+#endif
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local bool tAudioThread = false;
+thread_local bool tCountAllocations = false;
+thread_local quint64 tAllocationCount = 0;
+
+std::atomic<quint64> gAllocations{0};
+std::atomic<quint64> gFrees{0};
+std::atomic<quint64> gLocks{0};
+std::atomic<quint64> gUnderruns{0};
+std::atomic<quint64> gCallbacks{0};
+std::atomic<qint64> gMaxCallbackNs{0};
+std::array<std::atomic<quint64>, RtDiagnostics::kHistogramBuckets> gHistogram{};
+
+// Bucket upper bounds double from 50 us; the last bucket is open-ended.
+constexpr qint64 kFirstBucketUs = 50;
+
+int bucketFor(qint64 durationNs) {
+    const qint64 us = durationNs / 1000;
+    qint64 limit = kFirstBucketUs;
+    int bucket = 0;
+    while (bucket < RtDiagnostics::kHistogramBuckets - 1 && us >= limit) {
+        ++bucket;
+        limit *= 2;
+    }
+    return bucket;
+}
+
+QString bucketLabel(int bucket) {
+    const qint64 limitUs = kFirstBucketUs << bucket;
+    if (bucket == RtDiagnostics::kHistogramBuckets - 1) {
+        return QString(">= %1 ms").arg((kFirstBucketUs << (bucket - 1)) / 1000.0, 0, 'f', 1);
+    }
+    if (limitUs < 1000) return QString("< %1 us").arg(limitUs);
+    return QString("< %1 ms").arg(limitUs / 1000.0, 0, 'f', 1);
+}
+} // namespace
+
+RtDiagnostics::AudioThreadScope::AudioThreadScope()
+    : previous_(tAudioThread) {
+    tAudioThread = true;
+}
+
+RtDiagnostics::AudioThreadScope::~AudioThreadScope() { tAudioThread = previous_; }
+
+RtDiagnostics::AllocationCounter::AllocationCounter()
+    : start_(tAllocationCount), previous_(tCountAllocations) {
+    tCountAllocations = true;
+}
+
+RtDiagnostics::AllocationCounter::~AllocationCounter() { tCountAllocations = previous_; }
+
+quint64 RtDiagnostics::AllocationCounter::count() const { return tAllocationCount - start_; }
+
+bool RtDiagnostics::checksEnabled() {
+#ifdef MUSICPLAYER_RT_CHECKS
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool RtDiagnostics::isAudioThread() { return tAudioThread; }
+
+void RtDiagnostics::recordAllocation() { gAllocations.fetch_add(1, std::memory_order_relaxed); }
+void RtDiagnostics::recordFree() { gFrees.fetch_add(1, std::memory_order_relaxed); }
+void RtDiagnostics::recordLock() { gLocks.fetch_add(1, std::memory_order_relaxed); }
+void RtDiagnostics::recordUnderrun() { gUnderruns.fetch_add(1, std::memory_order_relaxed); }
+
+void RtDiagnostics::recordCallback(qint64 durationNs) {
+    gCallbacks.fetch_add(1, std::memory_order_relaxed);
+    gHistogram[bucketFor(durationNs)].fetch_add(1, std::memory_order_relaxed);
+    qint64 seen = gMaxCallbackNs.load(std::memory_order_relaxed);
+    while (durationNs > seen && !gMaxCallbackNs.compare_exchange_weak(seen, durationNs, std::memory_order_relaxed)) {}
+}
+
+RtDiagnostics::Snapshot RtDiagnostics::snapshot() {
+    Snapshot s;
+    s.allocations = gAllocations.load(std::memory_order_relaxed);
+    s.frees = gFrees.load(std::memory_order_relaxed);
+    s.locks = gLocks.load(std::memory_order_relaxed);
+    s.underruns = gUnderruns.load(std::memory_order_relaxed);
+    s.callbacks = gCallbacks.load(std::memory_order_relaxed);
+    s.maxCallbackNs = gMaxCallbackNs.load(std::memory_order_relaxed);
+    for (int i = 0; i < kHistogramBuckets; ++i) s.histogram[i] = gHistogram[i].load(std::memory_order_relaxed);
+    return s;
+}
+
+void RtDiagnostics::reset() {
+    gAllocations = 0;
+    gFrees = 0;
+    gLocks = 0;
+    gUnderruns = 0;
+    gCallbacks = 0;
+    gMaxCallbackNs = 0;
+    for (auto &bucket : gHistogram) bucket = 0;
+}
+
+QString RtDiagnostics::report() {
+    const Snapshot s = snapshot();
+    QStringList lines;
+    lines << "[Audio thread]";
+    if (checksEnabled()) {
+        lines << QString("RT violations: %1 allocations, %2 frees, %3 locks").arg(s.allocations).arg(s.frees).arg(s.locks);
+    } else {
+        lines << "RT violations: not instrumented (configure with MUSICPLAYER_RT_CHECKS=ON)";
+    }
+    lines << QString("Underruns: %1").arg(s.underruns);
+    lines << QString("Callbacks: %1 (max %2 ms)").arg(s.callbacks).arg(s.maxCallbackNs / 1e6, 0, 'f', 3);
+    for (int i = 0; i < kHistogramBuckets; ++i) {
+        if (s.histogram[i] == 0) continue;
+        lines << QString("  %1: %2").arg(bucketLabel(i), -10).arg(s.histogram[i]);
+    }
+    return lines.join('\n');
+}
+
+// --- Allocation hooks (MUSICPLAYER_RT_CHECKS builds only) ---
+//
+// Besides render-thread violations they feed AllocationCounter.
+//
+// On glibc the C allocator itself is interposed, which also covers operator new
+// and Qt's container allocations. Elsewhere only the C++ allocation functions
+// can be replaced portably.
+
+#ifdef MUSICPLAYER_RT_CHECKS
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) noexcept {
+    if (tAudioThread) RtDiagnostics::recordAllocation();
+    if (tCountAllocations) ++tAllocationCount;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept {
+    if (tAudioThread) RtDiagnostics::recordAllocation();
+    if (tCountAllocations) ++tAllocationCount;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept {
+    if (tAudioThread) RtDiagnostics::recordAllocation();
+    if (tCountAllocations) ++tAllocationCount;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) noexcept {
+    if (ptr && tAudioThread) RtDiagnostics::recordFree();
+    __libc_free(ptr);
+}
+}
+#else
+void *operator new(std::size_t size) {
+    if (tAudioThread) RtDiagnostics::recordAllocation();
+    if (tCountAllocations) ++tAllocationCount;
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+void operator delete(void *ptr) noexcept {
+    if (ptr && tAudioThread) RtDiagnostics::recordFree();
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept { ::operator delete(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { ::operator delete(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { ::operator delete(ptr); }
+#endif
+
+// --- Lock hooks ---
+//
+// pthread_mutex_lock/trylock are interposed like malloc, so std::mutex and any
+// lock the audio backend takes on the render thread are counted. The libc
+// versions are looked up once; glibc's own internal locking does not go
+// through these symbols, so the lookup cannot recurse. QMutex on Linux waits
+// on a futex directly and is not seen.
+#if defined(__GLIBC__)
+namespace {
+using MutexFunction = int (*)(pthread_mutex_t *);
+
+// Plain atomics rather than function statics: their guard may itself lock.
+std::atomic<MutexFunction> gNextLock{nullptr};
+std::atomic<MutexFunction> gNextTryLock{nullptr};
+
+MutexFunction nextMutexFunction(std::atomic<MutexFunction> &slot, const char *name) {
+    MutexFunction next = slot.load(std::memory_order_acquire);
+    if (!next) {
+        next = reinterpret_cast<MutexFunction>(dlsym(RTLD_NEXT, name));
+        slot.store(next, std::memory_order_release);
+    }
+    return next;
+}
+} // namespace
+
+extern "C" {
+int pthread_mutex_lock(pthread_mutex_t *mutex) noexcept {
+    if (tAudioThread) RtDiagnostics::recordLock();
+    return nextMutexFunction(gNextLock, "pthread_mutex_lock")(mutex);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t *mutex) noexcept {
+    if (tAudioThread) RtDiagnostics::recordLock();
+    return nextMutexFunction(gNextTryLock, "pthread_mutex_trylock")(mutex);
+}
+}
+#endif
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+#include <array>
+
+// Real-time safety instrumentation for the audio render path.
+//
+// The render callback marks its thread with AudioThreadScope. When the build is
+// configured with MUSICPLAYER_RT_CHECKS, heap allocations and pthread mutex
+// locks (ours, Qt's and the audio backend's) performed on a marked thread are
+// counted as violations. Underrun
+// and callback-duration statistics are always collected; they are plain
+// atomics and safe to update from the render thread.
+class RtDiagnostics final {
+public:
+    static constexpr int kHistogramBuckets = 12;
+
+    struct Snapshot {
+        quint64 allocations = 0;
+        quint64 frees = 0;
+        quint64 locks = 0;
+        quint64 underruns = 0;
+        quint64 callbacks = 0;
+        qint64 maxCallbackNs = 0;
+        std::array<quint64, kHistogramBuckets> histogram{};
+    };
+
+    class AudioThreadScope {
+    public:
+        AudioThreadScope();
+        ~AudioThreadScope();
+        AudioThreadScope(const AudioThreadScope &) = delete;
+        AudioThreadScope &operator=(const AudioThreadScope &) = delete;
+
+    private:
+        bool previous_;
+    };
+
+    // Counts heap allocations made on the constructing thread while alive.
+    // Only instrumented builds count; count() is 0 otherwise.
+    class AllocationCounter {
+    public:
+        AllocationCounter();
+        ~AllocationCounter();
+        AllocationCounter(const AllocationCounter &) = delete;
+        AllocationCounter &operator=(const AllocationCounter &) = delete;
+        quint64 count() const;
+
+    private:
+        quint64 start_;
+        bool previous_;
+    };
+
+    static bool checksEnabled();
+    static bool isAudioThread();
+    static void recordAllocation();
+    static void recordFree();
+    static void recordLock();
+    static void recordUnderrun();
+    static void recordCallback(qint64 durationNs);
+    static Snapshot snapshot();
+    static void reset();
+    static QString report();
+};
@@ -0,0 +1,90 @@
+#include "SingleInstance.h"
+
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QLocalSocket>
+#include <QStandardPaths>
+#include <QThread>
+
+namespace {
+constexpr int kConnectTimeoutMs = 500;
+constexpr int kWriteTimeoutMs = 2000;
+// How long a launch waits for a player that holds the lock but is not
+// listening yet, before starting on its own.
+constexpr int kStartupWaitMs = 5000;
+constexpr int kRetryMs = 100;
+
+QString instanceName() { return QString("MusicPlayer-%1").arg(qHash(QDir::homePath()), 0, 16); }
+
+QString lockPath(const QString &name) {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (dir.isEmpty()) dir = QDir::tempPath();
+    return dir + '/' + name + ".lock";
+}
+
+// One path per line, UTF-8; the sender closes the connection when done.
+QByteArray encodePaths(const QStringList &paths) { return paths.join('\n').toUtf8(); }
+
+QStringList decodePaths(const QByteArray &data) {
+    return QString::fromUtf8(data).split('\n', Qt::SkipEmptyParts);
+}
+} // namespace
+
+SingleInstance::SingleInstance(QObject *parent)
+    : QObject(parent),
+      lock_(lockPath(instanceName())),
+      name_(instanceName()) {
+    lock_.setStaleLockTime(0); // stale only once its owner has died, never by age
+    server_.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&server_, &QLocalServer::newConnection, this, &SingleInstance::acceptConnection);
+}
+
+bool SingleInstance::handOver(const QStringList &paths) {
+    const QDeadlineTimer deadline(kStartupWaitMs);
+    do {
+        if (lock_.tryLock(0)) {
+            if (!listen()) qWarning("SingleInstance: socket unavailable; other launches will start their own player");
+            return false;
+        }
+        if (forward(paths)) return true;
+        QThread::msleep(kRetryMs);
+    } while (!deadline.hasExpired());
+    qWarning("SingleInstance: running player did not answer; starting another one");
+    return false;
+}
+
+bool SingleInstance::forward(const QStringList &paths) {
+    QLocalSocket socket;
+    socket.connectToServer(name_);
+    if (!socket.waitForConnected(kConnectTimeoutMs)) return false;
+    socket.write(encodePaths(paths));
+    if (!socket.waitForBytesWritten(kWriteTimeoutMs)) return false;
+    socket.disconnectFromServer();
+    if (socket.state() != QLocalSocket::UnconnectedState) socket.waitForDisconnected(kWriteTimeoutMs);
+    return true;
+}
+
+bool SingleInstance::listen() {
+    if (server_.listen(name_)) return true;
+    // A socket left behind by a crashed player; holding the lock means
+    // nobody else serves on it.
+    if (server_.serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalServer::removeServer(name_);
+        return server_.listen(name_);
+    }
+    return false;
+}
+
+void SingleInstance::acceptConnection() {
+    while (QLocalSocket *socket = server_.nextPendingConnection()) {
+        // The socket buffers everything until the sender hangs up, which may
+        // have happened already.
+        const auto finish = [this, socket]() {
+            const QStringList paths = decodePaths(socket->readAll());
+            socket->deleteLater();
+            emit pathsReceived(paths);
+        };
+        if (socket->state() == QLocalSocket::UnconnectedState) finish();
+        else connect(socket, &QLocalSocket::disconnected, this, finish);
+    }
+}
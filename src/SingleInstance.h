@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QLocalServer>
+#include <QLockFile>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+// Keeps one player per user. A second launch hands its arguments to the
+// running player over a local socket and exits before building any UI; the
+// running player receives them through pathsReceived(). A lock file decides
+// who serves, so two players launched together cannot both start.
+class SingleInstance final : public QObject {
+    Q_OBJECT
+
+public:
+    explicit SingleInstance(QObject *parent = nullptr);
+
+    // Sends paths (possibly none) to the running player and returns true, or
+    // becomes the running player and returns false.
+    bool handOver(const QStringList &paths);
+
+signals:
+    void pathsReceived(const QStringList &paths);
+
+private:
+    bool forward(const QStringList &paths);
+    bool listen();
+    void acceptConnection();
+
+    QLocalServer server_;
+    QLockFile lock_;
+    QString name_;
+};
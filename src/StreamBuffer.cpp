@@ -0,0 +1,280 @@
+#include "StreamBuffer.h"
+
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// Held back before the first read and after every reconnect. Radio servers
+// announce their bitrate; otherwise assume 128 kbit/s.
+constexpr int kPrebufferSeconds = 3;
+constexpr qint64 kDefaultPrebufferBytes = 128 * 1000 / 8 * kPrebufferSeconds;
+constexpr int kInitialBackoffMs = 500;
+constexpr int kMaxBackoffMs = 30000;
+constexpr int kMaxAttempts = 8; // consecutive failures without any data
+constexpr int kReadWaitMs = 250;
+} // namespace
+
+StreamBuffer::StreamBuffer(const QUrl &url, QObject *parent)
+    : QIODevice(parent), url_(url) {
+    network_ = new QNetworkAccessManager(this);
+    reconnectTimer_ = new QTimer(this);
+    reconnectTimer_->setSingleShot(true);
+    connect(reconnectTimer_, &QTimer::timeout, this, &StreamBuffer::connectStream);
+}
+
+StreamBuffer::~StreamBuffer() { close(); }
+
+bool StreamBuffer::isStreamUrl(const QUrl &url) {
+    const QString scheme = url.scheme().toLower();
+    return scheme == "http" || scheme == "https";
+}
+
+void StreamBuffer::start() {
+    // Unbuffered: QIODevice's own buffer would not be safe to fill from a
+    // decoder thread.
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    connectStream();
+}
+
+qint64 StreamBuffer::bytesAvailable() const {
+    QMutexLocker lock(&mutex_);
+    return (prebuffering_ ? 0 : buffer_.size() - readOffset_) + QIODevice::bytesAvailable();
+}
+
+bool StreamBuffer::atEnd() const {
+    QMutexLocker lock(&mutex_);
+    return finished_ && readOffset_ == buffer_.size();
+}
+
+void StreamBuffer::close() {
+    reconnectTimer_->stop();
+    {
+        QMutexLocker lock(&mutex_);
+        finished_ = true;
+    }
+    dataReady_.wakeAll();
+    if (reply_) {
+        reply_->disconnect(this);
+        reply_->abort();
+        reply_->deleteLater();
+    }
+    QIODevice::close();
+}
+
+bool StreamBuffer::isLive() const {
+    QMutexLocker lock(&mutex_);
+    return live_;
+}
+
+QString StreamBuffer::streamTitle() const {
+    QMutexLocker lock(&mutex_);
+    return title_;
+}
+
+QString StreamBuffer::report() const {
+    QMutexLocker lock(&mutex_);
+    QStringList lines;
+    lines << "[Stream]";
+    lines << QString("URL: %1 (%2)").arg(url_.toDisplayString(), live_ ? "live" : "remote file");
+    lines << QString("Received: %1 KiB%2, queued: %3 KiB%4")
+                 .arg(received_ / 1024)
+                 .arg(contentLength_ >= 0 ? QString(" of %1 KiB").arg(contentLength_ / 1024) : QString())
+                 .arg((buffer_.size() - readOffset_) / 1024)
+                 .arg(prebuffering_ && !finished_ ? " (prebuffering)" : "");
+    lines << QString("Reconnects: %1%2").arg(reconnects_).arg(metaInterval_ > 0 ? ", ICY metadata every " + QString::number(metaInterval_) + " bytes" : QString());
+    if (!title_.isEmpty()) lines << QString("Title: %1").arg(title_);
+    return lines.join('\n');
+}
+
+qint64 StreamBuffer::readData(char *data, qint64 maxlen) {
+    QMutexLocker lock(&mutex_);
+    const bool blocking = QThread::currentThread() != thread();
+    for (;;) {
+        const qint64 queued = buffer_.size() - readOffset_;
+        if (queued > 0 && (!prebuffering_ || finished_)) {
+            const qint64 count = std::min(maxlen, queued);
+            std::memcpy(data, buffer_.constData() + readOffset_, size_t(count));
+            readOffset_ += count;
+            // Compacting once half the buffer is consumed keeps a stream that
+            // never fully drains from growing without bound, at amortized
+            // constant cost per byte.
+            if (readOffset_ == buffer_.size()) {
+                buffer_.clear();
+                readOffset_ = 0;
+            } else if (readOffset_ > buffer_.size() / 2) {
+                buffer_.remove(0, readOffset_);
+                readOffset_ = 0;
+            }
+            return count;
+        }
+        if (finished_ || !blocking) return 0;
+        dataReady_.wait(&mutex_, kReadWaitMs);
+    }
+}
+
+void StreamBuffer::connectStream() {
+    QNetworkRequest request(url_);
+    request.setRawHeader("Icy-MetaData", "1");
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    {
+        QMutexLocker lock(&mutex_);
+        if (headersSeen_ && !live_ && received_ > 0) request.setRawHeader("Range", "bytes=" + QByteArray::number(received_) + '-');
+        prebuffering_ = true;
+    }
+    replyOk_ = false;
+    reply_ = network_->get(request);
+    connect(reply_, &QNetworkReply::metaDataChanged, this, &StreamBuffer::handleHeaders);
+    connect(reply_, &QNetworkReply::readyRead, this, &StreamBuffer::handleData);
+    connect(reply_, &QNetworkReply::finished, this, &StreamBuffer::handleFinished);
+}
+
+void StreamBuffer::handleHeaders() {
+    const int status = reply_->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    replyOk_ = status >= 200 && status < 300;
+    if (!replyOk_) return;
+    metaInterval_ = reply_->rawHeader("icy-metaint").toLongLong();
+    audioUntilMeta_ = metaInterval_;
+    metaRemaining_ = -1;
+    metaBlock_.clear();
+    QMutexLocker lock(&mutex_);
+    if (!headersSeen_) {
+        headersSeen_ = true;
+        const QVariant length = reply_->header(QNetworkRequest::ContentLengthHeader);
+        contentLength_ = length.isValid() ? length.toLongLong() : -1;
+        live_ = contentLength_ < 0 || metaInterval_ > 0;
+    }
+    // A server that ignored the Range request starts over from byte 0.
+    skipOnResume_ = !live_ && status != 206 ? received_ : 0;
+}
+
+void StreamBuffer::handleData() {
+    const QByteArray data = reply_->readAll();
+    // The body of an error response (an HTML page for a 503) is not audio;
+    // handleFinished() decides whether to retry.
+    if (data.isEmpty() || !replyOk_) return;
+    attempts_ = 0; // the connection works again
+    const char *p = data.constData();
+    qint64 left = data.size();
+    if (skipOnResume_ > 0) {
+        const qint64 skipped = std::min(left, skipOnResume_);
+        skipOnResume_ -= skipped;
+        p += skipped;
+        left -= skipped;
+    }
+    while (left > 0) {
+        if (metaInterval_ <= 0) {
+            appendAudio(p, left);
+            break;
+        }
+        if (metaRemaining_ < 0 && audioUntilMeta_ > 0) {
+            const qint64 count = std::min(left, audioUntilMeta_);
+            appendAudio(p, count);
+            audioUntilMeta_ -= count;
+            p += count;
+            left -= count;
+        } else if (metaRemaining_ < 0) {
+            metaRemaining_ = int(uchar(*p)) * 16;
+            ++p;
+            --left;
+            metaBlock_.clear();
+            if (metaRemaining_ == 0) {
+                metaRemaining_ = -1;
+                audioUntilMeta_ = metaInterval_;
+            }
+        } else {
+            const qint64 count = std::min<qint64>(left, metaRemaining_);
+            metaBlock_.append(p, count);
+            metaRemaining_ -= int(count);
+            p += count;
+            left -= count;
+            if (metaRemaining_ == 0) {
+                parseMetadata(metaBlock_);
+                metaRemaining_ = -1;
+                audioUntilMeta_ = metaInterval_;
+            }
+        }
+    }
+}
+
+void StreamBuffer::handleFinished() {
+    QNetworkReply *reply = reply_;
+    reply_ = nullptr;
+    reply->deleteLater();
+    if (!isOpen()) return;
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status >= 400 && status < 500) {
+        // Wrong URL or forbidden: retrying will not help.
+        emit failed(QString("HTTP %1 for %2").arg(status).arg(url_.toDisplayString()));
+        finish();
+        return;
+    }
+    bool complete = false;
+    {
+        QMutexLocker lock(&mutex_);
+        complete = !live_ && contentLength_ >= 0 && received_ >= contentLength_;
+    }
+    if (complete) {
+        finish();
+        return;
+    }
+    scheduleReconnect(reply->error() != QNetworkReply::NoError ? reply->errorString() : QString("connection closed"));
+}
+
+void StreamBuffer::scheduleReconnect(const QString &reason) {
+    if (++attempts_ > kMaxAttempts) {
+        emit failed(QString("%1: %2").arg(url_.toDisplayString(), reason));
+        finish();
+        return;
+    }
+    ++reconnects_;
+    reconnectTimer_->start(std::min(kMaxBackoffMs, kInitialBackoffMs << (attempts_ - 1)));
+}
+
+void StreamBuffer::appendAudio(const char *data, qint64 size) {
+    bool released = false;
+    {
+        QMutexLocker lock(&mutex_);
+        buffer_.append(data, size);
+        received_ += size;
+        if (prebuffering_) {
+            const qint64 kbps = reply_ ? reply_->rawHeader("icy-br").toLongLong() : 0;
+            const qint64 threshold = kbps > 0 ? kbps * 1000 / 8 * kPrebufferSeconds : kDefaultPrebufferBytes;
+            prebuffering_ = buffer_.size() - readOffset_ < threshold;
+        }
+        released = !prebuffering_;
+    }
+    if (!released) return;
+    dataReady_.wakeAll();
+    emit readyRead();
+}
+
+void StreamBuffer::parseMetadata(const QByteArray &block) {
+    static const QRegularExpression kTitle("StreamTitle='(.*?)';");
+    const QRegularExpressionMatch match = kTitle.match(QString::fromUtf8(block));
+    if (!match.hasMatch()) return;
+    const QString title = match.captured(1).trimmed();
+    {
+        QMutexLocker lock(&mutex_);
+        if (title == title_) return;
+        title_ = title;
+    }
+    emit streamTitleChanged(title);
+}
+
+void StreamBuffer::finish() {
+    {
+        QMutexLocker lock(&mutex_);
+        finished_ = true;
+    }
+    dataReady_.wakeAll();
+    emit readyRead();
+    emit readChannelFinished();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QMutex>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QString>
+#include <QUrl>
+#include <QWaitCondition>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+// Sequential device over an HTTP stream (Icecast/Shoutcast radio or a remote
+// file) for QAudioDecoder::setSourceDevice().
+//
+// Incoming bytes pass through a jitter buffer: readers get nothing until a few
+// seconds of audio are queued (kPrebufferSeconds at the announced bitrate),
+// at the start and after every reconnect, so the decoder restarts with a
+// reserve instead of being fed byte by byte. Once released, reads take
+// whatever has arrived; the decoded PCM ahead of playback covers short stalls.
+// Interleaved ICY metadata is stripped and reported as stream titles. Dropped
+// connections are retried with exponential backoff; remote files resume with
+// a Range request, live streams simply reconnect.
+//
+// The network side lives on the owner's thread. readData() may be called from
+// a decoder thread, where it blocks until data arrives like a socket would.
+class StreamBuffer final : public QIODevice {
+    Q_OBJECT
+
+public:
+    explicit StreamBuffer(const QUrl &url, QObject *parent = nullptr);
+    ~StreamBuffer() override;
+
+    static bool isStreamUrl(const QUrl &url);
+
+    void start();
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+    bool atEnd() const override;
+    void close() override;
+
+    // False until the response headers arrived, then true for streams of
+    // unknown length (radio).
+    bool isLive() const;
+    QString streamTitle() const;
+    QString report() const;
+
+signals:
+    void streamTitleChanged(const QString &title);
+    void failed(const QString &message);
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    void connectStream();
+    void handleHeaders();
+    void handleData();
+    void handleFinished();
+    void scheduleReconnect(const QString &reason);
+    void appendAudio(const char *data, qint64 size);
+    void parseMetadata(const QByteArray &block);
+    void finish();
+
+    QUrl url_;
+    QNetworkAccessManager *network_ = nullptr;
+    QPointer<QNetworkReply> reply_;
+    QTimer *reconnectTimer_ = nullptr;
+    bool replyOk_ = false; // the current reply answered 2xx
+
+    // Shared with readers on other threads.
+    mutable QMutex mutex_;
+    QWaitCondition dataReady_;
+    QByteArray buffer_;
+    qsizetype readOffset_ = 0;
+    bool prebuffering_ = true;
+    bool finished_ = false;
+    bool live_ = false;
+    bool headersSeen_ = false;
+    QString title_;
+
+    // ICY framing: audio bytes until the next metadata block, then its length
+    // byte and body.
+    qint64 metaInterval_ = 0;
+    qint64 audioUntilMeta_ = 0;
+    int metaRemaining_ = -1; // -1: expecting audio or the length byte
+    QByteArray metaBlock_;
+
+    qint64 contentLength_ = -1;
+    qint64 received_ = 0; // audio bytes delivered into buffer_ in total
+    qint64 skipOnResume_ = 0;
+    int attempts_ = 0;
+    int reconnects_ = 0;
+};
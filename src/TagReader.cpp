@@ -0,0 +1,548 @@
+#include "TagReader.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QStringDecoder>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr qint64 kOggProbeBytes = 64 * 1024;
+// How far past the ID3 tag the first MPEG frame may start (junk, padding).
+constexpr qint64 kMpegSyncSearchBytes = 64 * 1024;
+// Ogg pages are at most 64 KiB, so the last page header is in this tail.
+constexpr qint64 kOggTailBytes = 66 * 1024;
+// Upper bound for a single metadata block we are willing to load.
+constexpr qint64 kMaxBlockBytes = 4 * 1024 * 1024;
+// Picture type of the front cover in ID3 APIC and FLAC PICTURE blocks.
+constexpr int kFrontCover = 3;
+
+quint32 syncsafe(const uchar *p) {
+    return (quint32(p[0] & 0x7F) << 21) | (quint32(p[1] & 0x7F) << 14) | (quint32(p[2] & 0x7F) << 7) | quint32(p[3] & 0x7F);
+}
+
+quint32 bigEndian24(const uchar *p) { return (quint32(p[0]) << 16) | (quint32(p[1]) << 8) | quint32(p[2]); }
+
+int parseTrackNumber(const QString &text) { return text.section('/', 0, 0).trimmed().toInt(); }
+
+QString firstValue(QString text) {
+    // ID3v2.4 separates multiple values with NUL.
+    const int nul = text.indexOf(QChar(0));
+    if (nul >= 0) text.truncate(nul);
+    return text.trimmed();
+}
+
+QString decodeUtf16(const QByteArray &data, QStringDecoder::Encoding encoding) {
+    QStringDecoder decoder(encoding);
+    return decoder(data);
+}
+
+QString decodeId3Text(const QByteArray &body) {
+    if (body.isEmpty()) return {};
+    const QByteArray data = body.mid(1);
+    switch (body.at(0)) {
+    case 1: {
+        if (data.size() >= 2 && uchar(data[0]) == 0xFE && uchar(data[1]) == 0xFF) {
+            return firstValue(decodeUtf16(data.mid(2), QStringDecoder::Utf16BE));
+        }
+        const QByteArray rest = (data.size() >= 2 && uchar(data[0]) == 0xFF && uchar(data[1]) == 0xFE) ? data.mid(2) : data;
+        return firstValue(decodeUtf16(rest, QStringDecoder::Utf16LE));
+    }
+    case 2: return firstValue(decodeUtf16(data, QStringDecoder::Utf16BE));
+    case 3: return firstValue(QString::fromUtf8(data));
+    default: return firstValue(QString::fromLatin1(data));
+    }
+}
+
+void applyId3Frame(TrackTags &tags, const QByteArray &id, const QByteArray &body) {
+    if (id == "TIT2" || id == "TT2") tags.title = decodeId3Text(body);
+    else if (id == "TPE1" || id == "TP1") tags.artist = decodeId3Text(body);
+    else if (id == "TPE2" || id == "TP2") tags.albumArtist = decodeId3Text(body);
+    else if (id == "TALB" || id == "TAL") tags.album = decodeId3Text(body);
+    else if (id == "TRCK" || id == "TRK") tags.trackNumber = parseTrackNumber(decodeId3Text(body));
+}
+
+// Calls visit(id, size) for each frame with the file positioned at the frame
+// body; visit returns false to stop.
+template <typename Visit>
+void walkId3Frames(QFile &file, const QByteArray &header, Visit visit) {
+    const uchar *h = reinterpret_cast<const uchar *>(header.constData());
+    const int version = h[3];
+    if (version < 2 || version > 4) return;
+    const qint64 tagEnd = 10 + syncsafe(h + 6);
+    const int frameHeaderSize = version == 2 ? 6 : 10;
+    const int idSize = version == 2 ? 3 : 4;
+
+    qint64 pos = 10;
+    if (h[5] & 0x40) {
+        // Extended header: v2.4 counts its own size, v2.3 does not.
+        if (!file.seek(pos)) return;
+        const QByteArray ext = file.read(4);
+        if (ext.size() < 4) return;
+        const uchar *e = reinterpret_cast<const uchar *>(ext.constData());
+        pos += version == 4 ? syncsafe(e) : 4 + qFromBigEndian<quint32>(e);
+    }
+
+    while (pos + frameHeaderSize <= tagEnd) {
+        if (!file.seek(pos)) return;
+        const QByteArray frameHeader = file.read(frameHeaderSize);
+        if (frameHeader.size() < frameHeaderSize || frameHeader.at(0) == 0) return; // padding
+        const uchar *f = reinterpret_cast<const uchar *>(frameHeader.constData());
+        const QByteArray id = frameHeader.left(idSize);
+        qint64 size = 0;
+        if (version == 2) size = bigEndian24(f + 3);
+        else if (version == 4) size = syncsafe(f + 4);
+        else size = qFromBigEndian<quint32>(f + 4);
+        pos += frameHeaderSize;
+        if (size <= 0 || pos + size > tagEnd) return;
+        if (!visit(id, size)) return;
+        pos += size;
+    }
+}
+
+void readId3v2(QFile &file, const QByteArray &header, TrackTags &tags) {
+    walkId3Frames(file, header, [&](const QByteArray &id, qint64 size) {
+        if (id.startsWith('T') && size <= kMaxBlockBytes) applyId3Frame(tags, id, file.read(size));
+        return true;
+    });
+}
+
+// Image data of an APIC (v2.3/2.4) or PIC (v2.2) frame body.
+QByteArray id3PictureData(const QByteArray &body, bool v22, int *pictureType) {
+    if (body.size() < 4) return {};
+    const char encoding = body.at(0);
+    qsizetype pos = 1;
+    if (v22) {
+        pos += 3; // image format
+    } else {
+        pos = body.indexOf('\0', pos);
+        if (pos < 0) return {};
+        ++pos;
+    }
+    if (pos >= body.size()) return {};
+    *pictureType = uchar(body.at(pos++));
+    // Description, terminated by one NUL (Latin-1/UTF-8) or an aligned pair (UTF-16).
+    if (encoding == 1 || encoding == 2) {
+        while (pos + 1 < body.size() && (body.at(pos) != 0 || body.at(pos + 1) != 0)) pos += 2;
+        pos += 2;
+    } else {
+        pos = body.indexOf('\0', pos);
+        if (pos < 0) return {};
+        ++pos;
+    }
+    return pos < body.size() ? body.mid(pos) : QByteArray();
+}
+
+QByteArray readId3Cover(QFile &file, const QByteArray &header) {
+    QByteArray cover;
+    const bool v22 = uchar(header.at(3)) == 2;
+    walkId3Frames(file, header, [&](const QByteArray &id, qint64 size) {
+        if ((id != "APIC" && id != "PIC") || size > kMaxBlockBytes) return true;
+        int type = 0;
+        const QByteArray data = id3PictureData(file.read(size), v22, &type);
+        if (!data.isEmpty() && (cover.isEmpty() || type == kFrontCover)) cover = data;
+        return type != kFrontCover;
+    });
+    return cover;
+}
+
+void parseVorbisComments(const QByteArray &block, TrackTags &tags) {
+    const uchar *p = reinterpret_cast<const uchar *>(block.constData());
+    const qint64 size = block.size();
+    qint64 pos = 0;
+    if (pos + 4 > size) return;
+    pos += 4 + qFromLittleEndian<quint32>(p + pos);
+    if (pos + 4 > size) return;
+    quint32 count = qFromLittleEndian<quint32>(p + pos);
+    pos += 4;
+    while (count-- > 0 && pos + 4 <= size) {
+        const qint64 length = qFromLittleEndian<quint32>(p + pos);
+        pos += 4;
+        if (pos + length > size) return;
+        const QString comment = QString::fromUtf8(block.constData() + pos, int(length));
+        pos += length;
+        const int eq = comment.indexOf('=');
+        if (eq <= 0) continue;
+        const QString key = comment.left(eq).toUpper();
+        const QString value = comment.mid(eq + 1).trimmed();
+        if (key == "TITLE") tags.title = value;
+        else if (key == "ARTIST") tags.artist = value;
+        else if (key == "ALBUMARTIST" || key == "ALBUM ARTIST") tags.albumArtist = value;
+        else if (key == "ALBUM") tags.album = value;
+        else if (key == "TRACKNUMBER") tags.trackNumber = parseTrackNumber(value);
+    }
+}
+
+void readFlac(QFile &file, TrackTags &tags) {
+    qint64 pos = 4;
+    for (bool last = false; !last;) {
+        if (!file.seek(pos)) return;
+        const QByteArray header = file.read(4);
+        if (header.size() < 4) return;
+        const uchar *h = reinterpret_cast<const uchar *>(header.constData());
+        last = h[0] & 0x80;
+        const int type = h[0] & 0x7F;
+        const qint64 length = bigEndian24(h + 1);
+        pos += 4;
+        if (type == 4) {
+            if (length <= kMaxBlockBytes) parseVorbisComments(file.read(length), tags);
+            return;
+        }
+        pos += length;
+    }
+}
+
+// Image data of a FLAC PICTURE block.
+QByteArray flacPictureData(const QByteArray &block, int *pictureType) {
+    const uchar *p = reinterpret_cast<const uchar *>(block.constData());
+    const qint64 size = block.size();
+    if (size < 8) return {};
+    *pictureType = int(qFromBigEndian<quint32>(p));
+    qint64 pos = 4;
+    pos += 4 + qFromBigEndian<quint32>(p + pos); // MIME type
+    if (pos + 4 > size) return {};
+    pos += 4 + qFromBigEndian<quint32>(p + pos); // description
+    pos += 16;                                    // width, height, depth, colours
+    if (pos + 4 > size) return {};
+    const qint64 length = qFromBigEndian<quint32>(p + pos);
+    pos += 4;
+    if (pos + length > size) return {};
+    return block.mid(pos, length);
+}
+
+QByteArray readFlacCover(QFile &file) {
+    QByteArray cover;
+    qint64 pos = 4;
+    for (bool last = false; !last;) {
+        if (!file.seek(pos)) break;
+        const QByteArray header = file.read(4);
+        if (header.size() < 4) break;
+        const uchar *h = reinterpret_cast<const uchar *>(header.constData());
+        last = h[0] & 0x80;
+        const int type = h[0] & 0x7F;
+        const qint64 length = bigEndian24(h + 1);
+        pos += 4;
+        if (type == 6 && length <= kMaxBlockBytes) {
+            int pictureType = 0;
+            const QByteArray data = flacPictureData(file.read(length), &pictureType);
+            if (!data.isEmpty() && (cover.isEmpty() || pictureType == kFrontCover)) cover = data;
+            if (pictureType == kFrontCover) break;
+        }
+        pos += length;
+    }
+    return cover;
+}
+
+void readOgg(QFile &file, TrackTags &tags) {
+    if (!file.seek(0)) return;
+    const QByteArray head = file.read(kOggProbeBytes);
+    int at = head.indexOf("\x03vorbis");
+    int skip = 7;
+    if (at < 0) {
+        at = head.indexOf("OpusTags");
+        skip = 8;
+    }
+    // The comment packet may continue on a later page; whatever fits in the
+    // first pages covers the text fields, which precede any artwork.
+    if (at >= 0) parseVorbisComments(head.mid(at + skip), tags);
+}
+
+// Finds a child box by type inside [begin, end) of a loaded MP4 box payload.
+bool findBox(const QByteArray &data, qint64 begin, qint64 end, const char *type, qint64 *payload, qint64 *payloadEnd) {
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    qint64 pos = begin;
+    while (pos + 8 <= end) {
+        qint64 size = qFromBigEndian<quint32>(p + pos);
+        qint64 headerSize = 8;
+        if (size == 1 && pos + 16 <= end) {
+            size = qint64(qFromBigEndian<quint64>(p + pos + 8));
+            headerSize = 16;
+        } else if (size == 0) {
+            size = end - pos;
+        }
+        if (size < headerSize || pos + size > end) return false;
+        if (std::memcmp(p + pos + 4, type, 4) == 0) {
+            *payload = pos + headerSize;
+            *payloadEnd = pos + size;
+            return true;
+        }
+        pos += size;
+    }
+    return false;
+}
+
+// Same as findBox, but over [begin, end) of the file, reading box headers only.
+bool findFileBox(QFile &file, qint64 begin, qint64 end, const char *type, qint64 *payload, qint64 *payloadEnd) {
+    qint64 pos = begin;
+    while (pos + 8 <= end) {
+        if (!file.seek(pos)) return false;
+        const QByteArray header = file.read(16);
+        if (header.size() < 8) return false;
+        const uchar *h = reinterpret_cast<const uchar *>(header.constData());
+        qint64 size = qFromBigEndian<quint32>(h);
+        qint64 headerSize = 8;
+        if (size == 1 && header.size() == 16) {
+            size = qint64(qFromBigEndian<quint64>(h + 8));
+            headerSize = 16;
+        } else if (size == 0) {
+            size = end - pos;
+        }
+        if (size < headerSize || pos + size > end) return false;
+        if (std::memcmp(h + 4, type, 4) == 0) {
+            *payload = pos + headerSize;
+            *payloadEnd = pos + size;
+            return true;
+        }
+        pos += size;
+    }
+    return false;
+}
+
+// Payload of the moov box, for the tag readers.
+QByteArray readMp4Moov(QFile &file) {
+    qint64 begin = 0, end = 0;
+    if (!findFileBox(file, 0, file.size(), "moov", &begin, &end) || end - begin > kMaxBlockBytes * 8) return {};
+    file.seek(begin);
+    return file.read(end - begin);
+}
+
+// Locates the ilst box of a loaded moov box.
+bool findMp4Ilst(const QByteArray &moov, qint64 *begin, qint64 *end) {
+    if (!findBox(moov, 0, moov.size(), "udta", begin, end)) return false;
+    if (!findBox(moov, *begin, *end, "meta", begin, end)) return false;
+    *begin += 4; // full box: version and flags
+    return findBox(moov, *begin, *end, "ilst", begin, end);
+}
+
+void readMp4(QFile &file, TrackTags &tags) {
+    const QByteArray moov = readMp4Moov(file);
+    qint64 begin = 0;
+    qint64 end = 0;
+    if (!findMp4Ilst(moov, &begin, &end)) return;
+
+    const auto text = [&](const char *type, QString *out) {
+        qint64 itemBegin = 0, itemEnd = 0, dataBegin = 0, dataEnd = 0;
+        if (!findBox(moov, begin, end, type, &itemBegin, &itemEnd)) return;
+        if (!findBox(moov, itemBegin, itemEnd, "data", &dataBegin, &dataEnd) || dataEnd - dataBegin < 8) return;
+        *out = QString::fromUtf8(moov.constData() + dataBegin + 8, int(dataEnd - dataBegin - 8)).trimmed();
+    };
+    text("\xA9nam", &tags.title);
+    text("\xA9" "ART", &tags.artist);
+    text("aART", &tags.albumArtist);
+    text("\xA9" "alb", &tags.album);
+
+    qint64 itemBegin = 0, itemEnd = 0, dataBegin = 0, dataEnd = 0;
+    if (findBox(moov, begin, end, "trkn", &itemBegin, &itemEnd)
+        && findBox(moov, itemBegin, itemEnd, "data", &dataBegin, &dataEnd) && dataEnd - dataBegin >= 12) {
+        tags.trackNumber = qFromBigEndian<quint16>(reinterpret_cast<const uchar *>(moov.constData()) + dataBegin + 10);
+    }
+}
+
+QByteArray readMp4Cover(QFile &file) {
+    const QByteArray moov = readMp4Moov(file);
+    qint64 begin = 0, end = 0, itemBegin = 0, itemEnd = 0, dataBegin = 0, dataEnd = 0;
+    if (!findMp4Ilst(moov, &begin, &end)) return {};
+    if (!findBox(moov, begin, end, "covr", &itemBegin, &itemEnd)) return {};
+    if (!findBox(moov, itemBegin, itemEnd, "data", &dataBegin, &dataEnd) || dataEnd - dataBegin <= 8) return {};
+    return moov.mid(dataBegin + 8, dataEnd - dataBegin - 8);
+}
+qint64 samplesToMs(qint64 samples, qint64 sampleRate) { return sampleRate > 0 && samples > 0 ? samples * 1000 / sampleRate : 0; }
+
+// Size of the ID3v2 tag at the start of the file (0 without one).
+qint64 id3v2Size(const QByteArray &header) {
+    if (!header.startsWith("ID3") || header.size() < 10) return 0;
+    const uchar *h = reinterpret_cast<const uchar *>(header.constData());
+    return 10 + syncsafe(h + 6) + ((h[5] & 0x10) ? 10 : 0);
+}
+
+struct MpegFrame {
+    int bitrateKbps = 0;
+    int sampleRate = 0;
+    int samplesPerFrame = 0;
+    int sideInfoSize = 0;
+};
+
+bool parseMpegHeader(const uchar *p, MpegFrame *frame) {
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) return false;
+    const int version = (p[1] >> 3) & 3; // 0: 2.5, 2: 2, 3: 1
+    const int layer = (p[1] >> 1) & 3;   // 1: III, 2: II, 3: I
+    const int bitrateIndex = p[2] >> 4;
+    const int rateIndex = (p[2] >> 2) & 3;
+    if (version == 1 || layer == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) return false;
+    static const int kRates[3] = {44100, 48000, 32000};
+    static const int kBitratesV1[3][15] = {
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},     // layer III
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},    // layer II
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448}, // layer I
+    };
+    static const int kBitratesV2[2][15] = {
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},         // layers II and III
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},    // layer I
+    };
+    const bool mpeg1 = version == 3;
+    frame->sampleRate = kRates[rateIndex] >> (mpeg1 ? 0 : version == 2 ? 1 : 2);
+    frame->bitrateKbps = mpeg1 ? kBitratesV1[layer - 1][bitrateIndex] : kBitratesV2[layer == 3 ? 1 : 0][bitrateIndex];
+    frame->samplesPerFrame = layer == 3 ? 384 : (layer == 1 && !mpeg1) ? 576 : 1152;
+    const bool mono = (p[3] >> 6) == 3;
+    frame->sideInfoSize = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+    return true;
+}
+
+qint64 mpegDurationMs(QFile &file, const QByteArray &header) {
+    const qint64 audioStart = id3v2Size(header);
+    if (!file.seek(audioStart)) return 0;
+    const QByteArray data = file.read(kMpegSyncSearchBytes);
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    qint64 at = 0;
+    MpegFrame frame;
+    while (at + 4 <= data.size() && !parseMpegHeader(p + at, &frame)) ++at;
+    if (at + 4 > data.size()) return 0;
+
+    // Xing/Info header in the first frame, right after the side information.
+    const qint64 xing = at + 4 + frame.sideInfoSize;
+    if (xing + 16 <= data.size() && (std::memcmp(p + xing, "Xing", 4) == 0 || std::memcmp(p + xing, "Info", 4) == 0)) {
+        const quint32 flags = qFromBigEndian<quint32>(p + xing + 4);
+        if (flags & 1) {
+            const qint64 frames = qFromBigEndian<quint32>(p + xing + 8);
+            qint64 samples = frames * frame.samplesPerFrame;
+            // The LAME extension follows the optional fields and records the
+            // encoder delay and padding that decoders trim.
+            const qint64 lame = xing + 8 + 4 + ((flags & 2) ? 4 : 0) + ((flags & 4) ? 100 : 0) + ((flags & 8) ? 4 : 0);
+            if (lame + 24 <= data.size() && std::memcmp(p + lame, "LAME", 4) == 0) {
+                const quint32 gapless = bigEndian24(p + lame + 21);
+                samples -= qint64(gapless >> 12) + qint64(gapless & 0xFFF);
+            }
+            return samplesToMs(samples, frame.sampleRate);
+        }
+    }
+    const qint64 vbri = at + 4 + 32;
+    if (vbri + 18 <= data.size() && std::memcmp(p + vbri, "VBRI", 4) == 0) {
+        return samplesToMs(qint64(qFromBigEndian<quint32>(p + vbri + 14)) * frame.samplesPerFrame, frame.sampleRate);
+    }
+    // Constant bitrate: the audio bytes say it all.
+    qint64 audioBytes = file.size() - audioStart - at;
+    if (file.seek(file.size() - 128) && file.read(3) == "TAG") audioBytes -= 128;
+    return frame.bitrateKbps > 0 ? audioBytes * 8 / frame.bitrateKbps : 0;
+}
+
+qint64 flacDurationMs(QFile &file, qint64 start) {
+    // STREAMINFO is always the first metadata block.
+    if (!file.seek(start + 4)) return 0;
+    const QByteArray block = file.read(4 + 18);
+    if (block.size() < 22 || (uchar(block.at(0)) & 0x7F) != 0) return 0;
+    const uchar *s = reinterpret_cast<const uchar *>(block.constData()) + 4;
+    const qint64 sampleRate = (qint64(s[10]) << 12) | (qint64(s[11]) << 4) | (s[12] >> 4);
+    const qint64 samples = (qint64(s[13] & 0x0F) << 32) | qFromBigEndian<quint32>(s + 14);
+    return samplesToMs(samples, sampleRate);
+}
+
+qint64 mp4DurationMs(QFile &file) {
+    // Only box headers on the way to mvhd are read, not the sample tables.
+    qint64 begin = 0, end = 0;
+    if (!findFileBox(file, 0, file.size(), "moov", &begin, &end)) return 0;
+    if (!findFileBox(file, begin, end, "mvhd", &begin, &end) || end - begin < 20 || !file.seek(begin)) return 0;
+    const QByteArray mvhd = file.read(std::min<qint64>(end - begin, 32));
+    const uchar *m = reinterpret_cast<const uchar *>(mvhd.constData());
+    if (m[0] == 1) {
+        if (mvhd.size() < 32) return 0;
+        return samplesToMs(qint64(qFromBigEndian<quint64>(m + 24)), qFromBigEndian<quint32>(m + 20));
+    }
+    if (mvhd.size() < 20) return 0;
+    return samplesToMs(qFromBigEndian<quint32>(m + 16), qFromBigEndian<quint32>(m + 12));
+}
+
+qint64 oggDurationMs(QFile &file) {
+    if (!file.seek(0)) return 0;
+    const QByteArray head = file.read(kOggProbeBytes);
+    if (head.size() < 28) return 0;
+    const quint32 serial = qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(head.constData()) + 14);
+    qint64 sampleRate = 0;
+    qint64 preSkip = 0;
+    int at = head.indexOf("vorbis");
+    if (at >= 0 && at + 15 <= head.size()) {
+        // "vorbis", then a 4-byte version and a 1-byte channel count.
+        sampleRate = qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(head.constData()) + at + 11);
+    } else if ((at = head.indexOf("OpusHead")) >= 0 && at + 12 <= head.size()) {
+        // Opus granules always count 48 kHz samples, including the pre-skip.
+        sampleRate = 48000;
+        preSkip = qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(head.constData()) + at + 10);
+    }
+    if (sampleRate <= 0) return 0;
+
+    const qint64 tailStart = std::max<qint64>(0, file.size() - kOggTailBytes);
+    if (!file.seek(tailStart)) return 0;
+    const QByteArray tail = file.read(kOggTailBytes);
+    const uchar *t = reinterpret_cast<const uchar *>(tail.constData());
+    for (qsizetype pos = tail.lastIndexOf("OggS"); pos >= 0; pos = pos > 0 ? tail.lastIndexOf("OggS", pos - 1) : -1) {
+        if (pos + 27 > tail.size() || t[pos + 4] != 0) continue;
+        if (qFromLittleEndian<quint32>(t + pos + 14) != serial) continue;
+        const qint64 granule = qint64(qFromLittleEndian<quint64>(t + pos + 6));
+        if (granule < 0) continue; // -1: no packet ends on this page
+        return samplesToMs(granule - preSkip, sampleRate);
+    }
+    return 0;
+}
+
+qint64 wavDurationMs(QFile &file) {
+    qint64 pos = 12;
+    qint64 byteRate = 0;
+    while (file.seek(pos)) {
+        const QByteArray chunk = file.read(20);
+        if (chunk.size() < 8) return 0;
+        const uchar *c = reinterpret_cast<const uchar *>(chunk.constData());
+        const qint64 size = qFromLittleEndian<quint32>(c + 4);
+        if (chunk.startsWith("fmt ") && chunk.size() >= 20) byteRate = qFromLittleEndian<quint32>(c + 16);
+        if (chunk.startsWith("data")) {
+            // Streamed WAVs leave the size at 0 or 0xFFFFFFFF.
+            const qint64 bytes = (size == 0 || size == 0xFFFFFFFF) ? file.size() - pos - 8 : size;
+            return byteRate > 0 ? bytes * 1000 / byteRate : 0;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return 0;
+}
+} // namespace
+
+qint64 readDurationMs(const QString &filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+    const QByteArray header = file.read(12);
+    if (header.size() < 12) return 0;
+    if (header.startsWith("fLaC")) return flacDurationMs(file, 0);
+    if (header.startsWith("OggS")) return oggDurationMs(file);
+    if (header.mid(4, 4) == "ftyp") return mp4DurationMs(file);
+    if (header.startsWith("RIFF") && header.mid(8, 4) == "WAVE") return wavDurationMs(file);
+    if (header.startsWith("ID3") || (uchar(header.at(0)) == 0xFF && (uchar(header.at(1)) & 0xE0) == 0xE0)) {
+        // An ID3 tag may also precede FLAC.
+        const qint64 tagSize = id3v2Size(header);
+        if (tagSize > 0 && file.seek(tagSize) && file.read(4) == "fLaC") return flacDurationMs(file, tagSize);
+        return mpegDurationMs(file, header);
+    }
+    return 0;
+}
+
+TrackTags readTags(const QString &filePath) {
+    TrackTags tags;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return tags;
+    const QByteArray header = file.read(10);
+    if (header.size() < 10) return tags;
+    if (header.startsWith("ID3")) readId3v2(file, header, tags);
+    else if (header.startsWith("fLaC")) readFlac(file, tags);
+    else if (header.startsWith("OggS")) readOgg(file, tags);
+    else if (header.mid(4, 4) == "ftyp") readMp4(file, tags);
+    return tags;
+}
+
+QByteArray readEmbeddedCover(const QString &filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return {};
+    const QByteArray header = file.read(10);
+    if (header.size() < 10) return {};
+    if (header.startsWith("ID3")) return readId3Cover(file, header);
+    if (header.startsWith("fLaC")) return readFlacCover(file);
+    if (header.mid(4, 4) == "ftyp") return readMp4Cover(file);
+    return {};
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+struct TrackTags {
+    QString title;
+    QString artist;
+    QString albumArtist;
+    QString album;
+    int trackNumber = 0;
+};
+
+// Reads the common text tags (ID3v2, FLAC/Ogg Vorbis comments, MP4 ilst)
+// without decoding audio. Only tag headers and the wanted frames are read;
+// embedded artwork is skipped over. Missing fields are left empty.
+TrackTags readTags(const QString &filePath);
+
+// Playing time from container headers, reading a few KiB: MP3 Xing/Info
+// (minus LAME encoder delay and padding), VBRI or the bitrate of a CBR
+// stream, FLAC STREAMINFO, MP4 mvhd, the last Ogg granule position and WAV
+// data size. 0 when unknown (e.g. raw AAC, which would need a full scan).
+qint64 readDurationMs(const QString &filePath);
+
+// Encoded image data of the embedded front cover (or the first picture when
+// none is marked as front cover); empty when there is none. Ogg artwork is not
+// read since it lives base64-encoded past the probed comment pages.
+QByteArray readEmbeddedCover(const QString &filePath);
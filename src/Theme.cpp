@@ -0,0 +1,373 @@
+#include "Theme.h"
+
+#include <QAbstractButton>
+#include <QAbstractItemView>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFont>
+#include <QHash>
+#include <QLineEdit>
+#include <QListView>
+#include <QPainter>
+#include <QPixmap>
+#include <QSlider>
+#include <QStyleOption>
+#include <QToolButton>
+#include <QWidget>
+
+#include <algorithm>
+
+namespace {
+// Widgets with a MusicBlue look of their own, keyed by objectName.
+enum class Role { None, Accent, Secondary, Nav, PlayPause, Stop, Sidebar, PlayerPanel, Seek };
+
+Role roleOf(const QWidget *widget) {
+    static const QHash<QString, Role> kRoles = {
+        {"accentButton", Role::Accent}, {"secondaryButton", Role::Secondary}, {"navButton", Role::Nav},
+        {"playPauseButton", Role::PlayPause}, {"stopButton", Role::Stop}, {"sidebar", Role::Sidebar},
+        {"playerPanel", Role::PlayerPanel}, {"seekSlider", Role::Seek},
+    };
+    return widget ? kRoles.value(widget->objectName(), Role::None) : Role::None;
+}
+
+// Rows of the main list views get the padded, underlined look; grids and the
+// folder tree stay compact.
+bool isPaddedRow(const QStyleOption *option, const QWidget *widget) {
+    const auto *item = qstyleoption_cast<const QStyleOptionViewItem *>(option);
+    return item && item->decorationPosition != QStyleOptionViewItem::Top && qobject_cast<const QListView *>(widget);
+}
+
+QColor hovered(const QColor &color) { return color.lightness() > 128 ? color.darker(106) : color.lighter(115); }
+
+void fillRounded(QPainter *painter, const QRectF &rect, qreal radius, const QColor &color) {
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(color);
+    painter->drawRoundedRect(rect, radius, radius);
+    painter->restore();
+}
+
+// Fills a role button; returns false for roles without a panel.
+bool drawButtonPanel(Role role, const QStyleOption *option, QPainter *painter) {
+    const QPalette &palette = option->palette;
+    const bool hover = option->state & QStyle::State_MouseOver;
+    const bool on = option->state & (QStyle::State_On | QStyle::State_Sunken);
+    const QRectF rect = option->rect;
+    const qreal round = std::min(rect.width(), rect.height()) / 2.0;
+    switch (role) {
+    case Role::Accent:
+        fillRounded(painter, rect, 12, hover ? hovered(palette.color(QPalette::Highlight)) : palette.color(QPalette::Highlight));
+        return true;
+    case Role::Secondary:
+        fillRounded(painter, rect, 12, hover ? palette.color(QPalette::Mid) : palette.color(QPalette::Button));
+        return true;
+    case Role::Nav:
+        if (on || hover) fillRounded(painter, rect, 10, palette.color(QPalette::Button));
+        return true;
+    case Role::PlayPause:
+        fillRounded(painter, rect, round, hover ? hovered(palette.color(QPalette::Highlight)) : palette.color(QPalette::Highlight));
+        return true;
+    case Role::Stop:
+        fillRounded(painter, rect, round, hover ? palette.color(QPalette::Mid) : palette.color(QPalette::Button));
+        return true;
+    default:
+        return false;
+    }
+}
+
+QColor labelColor(Role role, const QStyleOption *option) {
+    const QPalette &palette = option->palette;
+    const bool hover = option->state & QStyle::State_MouseOver;
+    switch (role) {
+    case Role::Accent:
+    case Role::PlayPause: return palette.color(QPalette::HighlightedText);
+    case Role::Secondary: return palette.color(QPalette::ButtonText);
+    case Role::Nav: return (option->state & QStyle::State_On) ? palette.color(QPalette::Highlight) : palette.color(QPalette::ButtonText);
+    default: return hover ? palette.color(QPalette::Highlight) : palette.color(QPalette::PlaceholderText);
+    }
+}
+
+QPalette makePalette(const char *window, const char *windowText, const char *base, const char *alternateBase,
+                     const char *text, const char *button, const char *mid, const char *midlight,
+                     const char *light, const char *muted) {
+    QPalette palette;
+    palette.setColor(QPalette::Window, QColor(window));
+    palette.setColor(QPalette::WindowText, QColor(windowText));
+    palette.setColor(QPalette::Base, QColor(base));
+    palette.setColor(QPalette::AlternateBase, QColor(alternateBase));
+    palette.setColor(QPalette::Text, QColor(text));
+    palette.setColor(QPalette::Button, QColor(button));
+    palette.setColor(QPalette::ButtonText, QColor(text));
+    palette.setColor(QPalette::Mid, QColor(mid));
+    palette.setColor(QPalette::Midlight, QColor(midlight));
+    palette.setColor(QPalette::Light, QColor(light));
+    palette.setColor(QPalette::PlaceholderText, QColor(muted));
+    palette.setColor(QPalette::Highlight, QColor("#4FB6FF"));
+    palette.setColor(QPalette::HighlightedText, QColor("#FFFFFF"));
+    palette.setColor(QPalette::Link, QColor("#4FB6FF"));
+    palette.setColor(QPalette::ToolTipBase, QColor(base));
+    palette.setColor(QPalette::ToolTipText, QColor(text));
+    palette.setColor(QPalette::Disabled, QPalette::Highlight, QColor(mid));
+    palette.setColor(QPalette::Disabled, QPalette::Text, QColor(muted));
+    palette.setColor(QPalette::Disabled, QPalette::ButtonText, QColor(muted));
+    return palette;
+}
+} // namespace
+
+MusicBlueStyle::MusicBlueStyle()
+    : QProxyStyle(QStringLiteral("Fusion")) {}
+
+void MusicBlueStyle::polish(QWidget *widget) {
+    QProxyStyle::polish(widget);
+    if (auto *view = qobject_cast<QAbstractItemView *>(widget)) {
+        // Item views sit directly on the window background.
+        view->viewport()->setBackgroundRole(QPalette::Window);
+        view->viewport()->setAttribute(Qt::WA_Hover);
+        return;
+    }
+    if (qobject_cast<QAbstractButton *>(widget) || qobject_cast<QSlider *>(widget) || qobject_cast<QLineEdit *>(widget)) {
+        widget->setAttribute(Qt::WA_Hover);
+    }
+    const Role role = roleOf(widget);
+    if (role == Role::Accent || role == Role::Secondary || (role == Role::None && qobject_cast<QToolButton *>(widget))) {
+        QFont font = widget->font();
+        font.setBold(true);
+        if (role != Role::None) font.setPixelSize(role == Role::Accent ? 13 : 12);
+        widget->setFont(font);
+    } else if (role == Role::Nav) {
+        QFont font = widget->font();
+        font.setPixelSize(13);
+        widget->setFont(font);
+    }
+}
+
+void MusicBlueStyle::unpolish(QWidget *widget) {
+    if (auto *view = qobject_cast<QAbstractItemView *>(widget)) view->viewport()->setBackgroundRole(QPalette::Base);
+    QProxyStyle::unpolish(widget);
+}
+
+void MusicBlueStyle::drawPrimitive(PrimitiveElement element, const QStyleOption *option, QPainter *painter,
+                                   const QWidget *widget) const {
+    const QPalette &palette = option->palette;
+    switch (element) {
+    case PE_PanelLineEdit: {
+        const bool focus = option->state & State_HasFocus;
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+        painter->setPen(QPen(focus ? palette.color(QPalette::Highlight) : palette.color(QPalette::Light), 1));
+        painter->setBrush(palette.color(QPalette::Base));
+        painter->drawRoundedRect(QRectF(option->rect).adjusted(0.5, 0.5, -0.5, -0.5), 10, 10);
+        painter->restore();
+        return;
+    }
+    case PE_FrameLineEdit:
+        return;
+    case PE_FrameFocusRect:
+        if (qobject_cast<const QAbstractItemView *>(widget) || roleOf(widget) != Role::None) return;
+        break;
+    case PE_PanelItemViewItem:
+        if (const auto *item = qstyleoption_cast<const QStyleOptionViewItem *>(option)) {
+            const bool padded = isPaddedRow(item, widget);
+            const QRectF rect = QRectF(option->rect).adjusted(1, 1, -1, padded ? -2 : -1);
+            if (option->state & State_Selected) fillRounded(painter, rect, 8, palette.color(QPalette::Highlight));
+            else if (option->state & State_MouseOver) fillRounded(painter, rect, 8, palette.color(QPalette::Button));
+            if (padded && !(option->state & State_Selected)) {
+                painter->save();
+                painter->setPen(palette.color(QPalette::Midlight));
+                painter->drawLine(option->rect.bottomLeft(), option->rect.bottomRight());
+                painter->restore();
+            }
+            return;
+        }
+        break;
+    case PE_PanelButtonTool:
+    case PE_PanelButtonCommand: {
+        const Role role = roleOf(widget);
+        if (drawButtonPanel(role, option, painter)) return;
+        // Plain tool buttons are flat text/icon buttons.
+        if (element == PE_PanelButtonTool && role == Role::None) return;
+        break;
+    }
+    case PE_FrameButtonTool:
+    case PE_FrameDefaultButton:
+        if (roleOf(widget) != Role::None || qobject_cast<const QToolButton *>(widget)) return;
+        break;
+    default:
+        break;
+    }
+    QProxyStyle::drawPrimitive(element, option, painter, widget);
+}
+
+void MusicBlueStyle::drawControl(ControlElement element, const QStyleOption *option, QPainter *painter,
+                                 const QWidget *widget) const {
+    const Role role = roleOf(widget);
+    switch (element) {
+    case CE_ShapedFrame:
+        if (role == Role::Sidebar) {
+            painter->fillRect(option->rect, option->palette.color(QPalette::AlternateBase));
+            painter->setPen(option->palette.color(QPalette::Mid));
+            painter->drawLine(option->rect.topRight(), option->rect.bottomRight());
+            return;
+        }
+        if (role == Role::PlayerPanel) {
+            painter->save();
+            painter->setRenderHint(QPainter::Antialiasing);
+            painter->setPen(option->palette.color(QPalette::Mid));
+            painter->setBrush(option->palette.color(QPalette::Base));
+            painter->drawRoundedRect(QRectF(option->rect).adjusted(0.5, 0.5, -0.5, -0.5), 20, 20);
+            painter->restore();
+            return;
+        }
+        break;
+    case CE_ToolButtonLabel:
+        if (const auto *button = qstyleoption_cast<const QStyleOptionToolButton *>(option)) {
+            QStyleOptionToolButton copy(*button);
+            copy.palette.setColor(QPalette::ButtonText, labelColor(role, option));
+            if (role == Role::Nav && button->toolButtonStyle == Qt::ToolButtonTextOnly) {
+                drawItemText(painter, copy.rect.adjusted(12, 0, -12, 0), Qt::AlignLeft | Qt::AlignVCenter | Qt::TextShowMnemonic,
+                             copy.palette, copy.state & State_Enabled, copy.text, QPalette::ButtonText);
+                return;
+            }
+            QProxyStyle::drawControl(element, &copy, painter, widget);
+            return;
+        }
+        break;
+    case CE_PushButtonLabel:
+        if (const auto *button = qstyleoption_cast<const QStyleOptionButton *>(option); button && role != Role::None) {
+            QStyleOptionButton copy(*button);
+            copy.palette.setColor(QPalette::ButtonText, labelColor(role, option));
+            QProxyStyle::drawControl(element, &copy, painter, widget);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+    QProxyStyle::drawControl(element, option, painter, widget);
+}
+
+void MusicBlueStyle::drawComplexControl(ComplexControl control, const QStyleOptionComplex *option, QPainter *painter,
+                                        const QWidget *widget) const {
+    if (control == CC_Slider) {
+        const auto *slider = qstyleoption_cast<const QStyleOptionSlider *>(option);
+        if (slider && slider->orientation == Qt::Horizontal) {
+            const QRect groove = subControlRect(CC_Slider, slider, SC_SliderGroove, widget);
+            const QRect handle = subControlRect(CC_Slider, slider, SC_SliderHandle, widget);
+            const QRectF track(groove.left(), groove.center().y() - 2.5, groove.width(), 6);
+            fillRounded(painter, track, 3, option->palette.color(QPalette::Mid));
+            if (roleOf(widget) == Role::Seek) {
+                QRectF done = track;
+                done.setRight(handle.center().x());
+                fillRounded(painter, done, 3, option->palette.color(QPalette::Highlight));
+            }
+            QRectF knob(0, 0, 14, 14);
+            knob.moveCenter(QRectF(handle).center());
+            const QColor color = option->palette.color(QPalette::Highlight);
+            fillRounded(painter, knob, 7, (option->state & State_MouseOver) ? hovered(color) : color);
+            return;
+        }
+    }
+    QProxyStyle::drawComplexControl(control, option, painter, widget);
+}
+
+int MusicBlueStyle::pixelMetric(PixelMetric metric, const QStyleOption *option, const QWidget *widget) const {
+    switch (metric) {
+    case PM_SliderLength:
+    case PM_SliderControlThickness: return 14;
+    case PM_ButtonShiftHorizontal:
+    case PM_ButtonShiftVertical: return 0;
+    default: return QProxyStyle::pixelMetric(metric, option, widget);
+    }
+}
+
+QSize MusicBlueStyle::sizeFromContents(ContentsType type, const QStyleOption *option, const QSize &size,
+                                       const QWidget *widget) const {
+    QSize result = QProxyStyle::sizeFromContents(type, option, size, widget);
+    if (type == CT_ItemViewItem) {
+        // List rows get the generous padding of the original design.
+        if (isPaddedRow(option, widget)) result += QSize(0, 26);
+    } else if (type == CT_LineEdit) {
+        result += QSize(0, 14);
+    } else if (type == CT_ToolButton && roleOf(widget) == Role::Nav) {
+        result += QSize(24, 14);
+    }
+    return result;
+}
+
+QRect MusicBlueStyle::subElementRect(SubElement element, const QStyleOption *option, const QWidget *widget) const {
+    QRect rect = QProxyStyle::subElementRect(element, option, widget);
+    if (element == SE_ItemViewItemText || element == SE_ItemViewItemDecoration) {
+        if (isPaddedRow(option, widget)) rect.translate(12, 0);
+    } else if (element == SE_LineEditContents) {
+        rect.adjust(8, 0, -8, 0);
+    }
+    return rect;
+}
+
+namespace Theme {
+QPalette palette(Kind kind) {
+    if (kind == Kind::Dark) {
+        return makePalette("#101A24", "#E6F2FF", "#16222E", "#132030", "#CFE6FF", "#1C2C3C", "#24384A", "#1E3040",
+                           "#2A4258", "#6FA9CC");
+    }
+    return makePalette("#F7FBFF", "#1F4B6E", "#FFFFFF", "#F1F8FF", "#2E5A7A", "#EAF5FF", "#DDEEFF", "#ECF5FF",
+                       "#CFE6FF", "#5AA9D6");
+}
+
+void apply(Kind kind) {
+    if (!dynamic_cast<MusicBlueStyle *>(QApplication::style())) QApplication::setStyle(new MusicBlueStyle);
+    // A palette change repaints; it does not re-polish like a style sheet does.
+    QApplication::setPalette(palette(kind));
+}
+
+QString legacyStyleSheet() {
+    return QStringLiteral(
+        "QMainWindow { background-color: #F7FBFF; }"
+        "#sidebar { background-color: #F1F8FF; border-right: 1px solid #DDEEFF; }"
+        "#sidebar QLabel { color: #5AA9D6; font-weight: bold; font-size: 11px; }"
+        "QLineEdit { background-color: #FFFFFF; border: 1px solid #CFE6FF; border-radius: 10px; padding: 10px; color: #1F4B6E; }"
+        "QLineEdit:focus { border: 1px solid #4FB6FF; }"
+        "QListView { background-color: transparent; outline: none; }"
+        "QListView::item { padding: 15px; border-bottom: 1px solid #ECF5FF; color: #2E5A7A; border-radius: 8px; margin-bottom: 2px; }"
+        "QListView::item:hover { background-color: #EAF5FF; }"
+        "QListView::item:selected { background-color: #4FB6FF; color: #FFFFFF; }"
+        "#albumGrid::item { padding: 6px; border-bottom: none; }"
+        "#accentButton { background-color: #4FB6FF; color: white; border-radius: 12px; font-weight: bold; font-size: 13px; }"
+        "#accentButton:hover { background-color: #36A6F5; }"
+        "#secondaryButton { background-color: #EAF5FF; color: #2E5A7A; border-radius: 12px; font-weight: bold; font-size: 12px; }"
+        "#secondaryButton:hover { background-color: #DDEEFF; }"
+        "#navButton { text-align: left; padding: 8px 12px; border-radius: 10px; color: #2E5A7A; font-size: 13px; }"
+        "#navButton:checked { background-color: #EAF5FF; color: #4FB6FF; }"
+        "#playerPanel { background-color: #FFFFFF; border: 1px solid #DDEEFF; border-radius: 20px; }"
+        "#playPauseButton { background-color: #4FB6FF; border-radius: 25px; color: white; }"
+        "#playPauseButton:hover { background-color: #36A6F5; }"
+        "#stopButton { background-color: #EEF6FF; border-radius: 18px; }"
+        "QSlider::groove:horizontal { height: 6px; background: #DDEEFF; border-radius: 3px; }"
+        "QSlider::handle:horizontal { width: 14px; height: 14px; margin: -4px 0; background: #4FB6FF; border-radius: 7px; }"
+        "#seekSlider::sub-page:horizontal { background: #4FB6FF; border-radius: 3px; }"
+        "QToolButton { border: none; color: #5AA9D6; font-weight: bold; }"
+        "QToolButton:hover { color: #4FB6FF; }");
+}
+
+QString benchmarkPaint(QWidget *root, int frames) {
+    const qreal ratio = root->devicePixelRatioF();
+    QPixmap canvas(root->size() * ratio);
+    canvas.setDevicePixelRatio(ratio);
+    const auto measure = [&]() {
+        root->render(&canvas); // warm-up: polish, layouts, glyph caches
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < frames; ++i) root->render(&canvas);
+        return timer.nsecsElapsed() / 1000.0 / frames;
+    };
+    const double styled = measure();
+    const QString previous = root->styleSheet();
+    root->setStyleSheet(legacyStyleSheet());
+    const double sheet = measure();
+    root->setStyleSheet(previous);
+    return QString("[Paint benchmark]\n%1 frames at %2x%3: style %4 µs/frame, style sheet %5 µs/frame (%6x)")
+        .arg(frames).arg(root->width()).arg(root->height())
+        .arg(styled, 0, 'f', 0).arg(sheet, 0, 'f', 0).arg(styled > 0 ? sheet / styled : 0.0, 0, 'f', 2);
+}
+} // namespace Theme
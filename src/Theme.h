@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QPalette>
+#include <QProxyStyle>
+#include <QString>
+
+class QWidget;
+
+// The MusicBlue look as a style and a palette instead of a style sheet.
+//
+// MusicBlueStyle paints the custom widgets (identified by objectName) with
+// colours taken from the option palette only, so switching themes is a
+// palette change: widgets repaint but are never re-polished.
+class MusicBlueStyle final : public QProxyStyle {
+public:
+    MusicBlueStyle();
+
+    void polish(QWidget *widget) override;
+    void unpolish(QWidget *widget) override;
+    void drawPrimitive(PrimitiveElement element, const QStyleOption *option, QPainter *painter,
+                       const QWidget *widget = nullptr) const override;
+    void drawControl(ControlElement element, const QStyleOption *option, QPainter *painter,
+                     const QWidget *widget = nullptr) const override;
+    void drawComplexControl(ComplexControl control, const QStyleOptionComplex *option, QPainter *painter,
+                            const QWidget *widget = nullptr) const override;
+    int pixelMetric(PixelMetric metric, const QStyleOption *option = nullptr, const QWidget *widget = nullptr) const override;
+    QSize sizeFromContents(ContentsType type, const QStyleOption *option, const QSize &size,
+                           const QWidget *widget = nullptr) const override;
+    QRect subElementRect(SubElement element, const QStyleOption *option, const QWidget *widget = nullptr) const override;
+};
+
+namespace Theme {
+enum class Kind { Light, Dark };
+
+QPalette palette(Kind kind);
+// Installs MusicBlueStyle once and the palette of kind.
+void apply(Kind kind);
+
+// The style sheet the window used before MusicBlueStyle, kept only as the
+// baseline of benchmarkPaint().
+QString legacyStyleSheet();
+// Renders root offscreen frames times with the current style, then with the
+// legacy style sheet applied to root, and reports the mean time per frame.
+QString benchmarkPaint(QWidget *root, int frames);
+} // namespace Theme
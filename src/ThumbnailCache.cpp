@@ -0,0 +1,230 @@
+#include "ThumbnailCache.h"
+#include "ContentHash.h"
+#include "TagReader.h"
+
+#include <QBuffer>
+#include <QColor>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFont>
+#include <QImageReader>
+#include <QPainter>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+constexpr int kThumbnailThreads = 2;
+constexpr int kJpegQuality = 85;
+constexpr int kMemoryBudgetKiB = 48 * 1024;
+constexpr qint64 kMaxDiskBytes = qint64(96) * 1024 * 1024;
+// Thumbnails written between two trims of the disk cache.
+constexpr int kDiskTrimInterval = 256;
+
+QImage decodeScaled(QImageReader &reader) {
+    // Scaling inside the reader lets JPEG decode at reduced resolution.
+    reader.setAutoTransform(true);
+    const QSize size = reader.size();
+    const int edge = ThumbnailCache::kThumbnailSize;
+    if (size.isValid() && (size.width() > edge || size.height() > edge)) {
+        reader.setScaledSize(size.scaled(edge, edge, Qt::KeepAspectRatio));
+    }
+    QImage image = reader.read();
+    if (!image.isNull() && (image.width() > edge || image.height() > edge)) {
+        image = image.scaled(edge, edge, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return image;
+}
+
+// An image file next to the track, preferring the usual cover names.
+QString folderCover(const QDir &dir) {
+    static const QStringList kFilters = {"*.jpg", "*.jpeg", "*.png", "*.webp", "*.bmp"};
+    static const QStringList kPreferred = {"cover", "folder", "front", "albumart", "album"};
+    const QStringList images = dir.entryList(kFilters, QDir::Files, QDir::Name);
+    if (images.isEmpty()) return {};
+    for (const QString &name : kPreferred) {
+        for (const QString &image : images) {
+            if (QFileInfo(image).completeBaseName().compare(name, Qt::CaseInsensitive) == 0) return dir.filePath(image);
+        }
+    }
+    return dir.filePath(images.first());
+}
+
+QImage renderThumbnail(const QString &sourcePath) {
+    const QString coverPath = folderCover(QFileInfo(sourcePath).dir());
+    if (!coverPath.isEmpty()) {
+        QImageReader reader(coverPath);
+        const QImage image = decodeScaled(reader);
+        if (!image.isNull()) return image;
+    }
+    QByteArray embedded = readEmbeddedCover(sourcePath);
+    if (embedded.isEmpty()) return {};
+    QBuffer buffer(&embedded);
+    QImageReader reader(&buffer);
+    return decodeScaled(reader);
+}
+
+QPixmap makePlaceholder() {
+    const int edge = ThumbnailCache::kThumbnailSize;
+    QPixmap pixmap(edge, edge);
+    pixmap.fill(Qt::transparent);
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor("#EAF5FF"));
+    painter.drawRoundedRect(pixmap.rect(), 12, 12);
+    QFont font = painter.font();
+    font.setPixelSize(edge / 3);
+    painter.setFont(font);
+    painter.setPen(QColor("#9CCFF2"));
+    painter.drawText(pixmap.rect(), Qt::AlignCenter, QString(QChar(0x266A)));
+    return pixmap;
+}
+
+void trimDiskCache(const QString &directory) {
+    // Newest first; whatever falls beyond the budget goes, oldest first.
+    const QFileInfoList files = QDir(directory).entryInfoList({"*.jpg"}, QDir::Files, QDir::Time);
+    qint64 total = 0;
+    for (const QFileInfo &file : files) {
+        total += file.size();
+        if (total > kMaxDiskBytes) QFile::remove(file.absoluteFilePath());
+    }
+}
+} // namespace
+
+// Loads one thumbnail from the disk cache, or renders and stores it. Tasks
+// are owned by ThumbnailCache (autoDelete is off) so a pointer that is still
+// in pending_ can never be reused by a newer task.
+class ThumbnailCache::Task final : public QRunnable {
+public:
+    Task(ThumbnailCache *owner, int key, QString cacheFile, QString sourcePath)
+        : owner_(owner), key_(key), cacheFile_(std::move(cacheFile)), sourcePath_(std::move(sourcePath)) {
+        setAutoDelete(false);
+    }
+
+    int key() const { return key_; }
+    // Whether run() rendered the thumbnail and wrote a new cache file.
+    bool rendered() const { return rendered_; }
+
+    void run() override {
+        const QImage image = load();
+        ThumbnailCache *owner = owner_;
+        QMetaObject::invokeMethod(owner, [owner, task = this, image]() { owner->finish(task, image); }, Qt::QueuedConnection);
+    }
+
+private:
+    QImage load() {
+        const QFileInfo cached(cacheFile_);
+        if (cached.exists()) {
+            // An empty entry records "no artwork" until the album folder changes.
+            if (cached.size() == 0) {
+                if (QFileInfo(QFileInfo(sourcePath_).absolutePath()).lastModified() <= cached.lastModified()) return {};
+            } else {
+                const QImage image(cacheFile_);
+                if (!image.isNull()) return image;
+            }
+        }
+        const QImage image = renderThumbnail(sourcePath_);
+        rendered_ = true;
+        QSaveFile file(cacheFile_);
+        if (file.open(QIODevice::WriteOnly)) {
+            if (image.isNull() || image.convertToFormat(QImage::Format_RGB32).save(&file, "JPG", kJpegQuality)) file.commit();
+        }
+        return image;
+    }
+
+    ThumbnailCache *owner_;
+    int key_;
+    QString cacheFile_;
+    QString sourcePath_;
+    bool rendered_ = false;
+};
+
+ThumbnailCache::ThumbnailCache(QObject *parent)
+    : QObject(parent), pixmaps_(kMemoryBudgetKiB) {
+    pool_.setMaxThreadCount(kThumbnailThreads);
+    directory_ = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails";
+    QDir().mkpath(directory_);
+    placeholder_ = makePlaceholder();
+    trimDisk();
+}
+
+ThumbnailCache::~ThumbnailCache() {
+    // Queued results posted to this object are dropped with it; every task,
+    // queued or finished-but-unreported, is still listed in pending_.
+    pool_.clear();
+    pool_.waitForDone();
+    qDeleteAll(pending_);
+}
+
+QPixmap ThumbnailCache::thumbnail(int key) const {
+    const QPixmap *pixmap = pixmaps_.object(key);
+    return pixmap ? *pixmap : placeholder_;
+}
+
+bool ThumbnailCache::isResolved(int key) const { return pixmaps_.contains(key) || missing_.contains(key); }
+
+void ThumbnailCache::request(int key, const QString &cacheKey, const QString &sourcePath, int priority) {
+    if (isResolved(key)) return;
+    if (Task *task = pending_.value(key)) {
+        // Still queued: move it to the new priority. Running: let it finish.
+        if (pool_.tryTake(task)) pool_.start(task, priority);
+        return;
+    }
+    const QByteArray name = cacheKey.toUtf8();
+    const QString file = QString("%1/%2.jpg").arg(directory_).arg(xxHash64(name.constData(), name.size()), 16, 16, QLatin1Char('0'));
+    auto *task = new Task(this, key, file, sourcePath);
+    pending_.insert(key, task);
+    pool_.start(task, priority);
+}
+
+void ThumbnailCache::retainOnly(const QSet<int> &keys) {
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (!keys.contains(it.key()) && pool_.tryTake(it.value())) {
+            delete it.value();
+            it = pending_.erase(it);
+            ++cancelled_;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ThumbnailCache::finish(Task *task, const QImage &image) {
+    const int key = task->key();
+    if (pending_.value(key) == task) pending_.remove(key);
+    if (task->rendered() && ++rendered_ % kDiskTrimInterval == 0) trimDisk();
+    delete task;
+    ++decoded_;
+    if (image.isNull()) {
+        missing_.insert(key);
+    } else {
+        const qsizetype cost = std::max<qsizetype>(1, image.sizeInBytes() / 1024);
+        pixmaps_.insert(key, new QPixmap(QPixmap::fromImage(image)), cost);
+    }
+    emit thumbnailReady(key);
+}
+
+void ThumbnailCache::trimDisk() {
+    // Behind every thumbnail request; listing a large cache takes a while.
+    pool_.start([directory = directory_]() { trimDiskCache(directory); }, std::numeric_limits<int>::min());
+}
+
+void ThumbnailCache::trimTo(qint64 bytes) {
+    // QCache evicts in LRU order when its limit shrinks; the limit is then
+    // restored so the cache may grow again once memory is available.
+    pixmaps_.setMaxCost(qsizetype(std::max<qint64>(0, bytes / 1024)));
+    pixmaps_.setMaxCost(kMemoryBudgetKiB);
+}
+
+QString ThumbnailCache::report() const {
+    return QString("[Thumbnails]\nIn memory: %1 (%2 / %3 KiB), without artwork: %4\nLoaded: %5, queued: %6, cancelled: %7")
+        .arg(pixmaps_.count()).arg(pixmaps_.totalCost()).arg(pixmaps_.maxCost()).arg(missing_.size())
+        .arg(decoded_).arg(pending_.size()).arg(cancelled_);
+}
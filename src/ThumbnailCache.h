@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+// Asynchronous album-art thumbnails.
+//
+// Requests are decoded on a private thread pool in priority order; requests
+// that scroll out of interest are taken back off the queue before they run.
+// Decoded thumbnails are kept in an in-memory LRU and persisted as JPEG in the
+// cache directory, so a cover is only ever decoded at full size once. The
+// directory is capped in size; the oldest files go first.
+class ThumbnailCache final : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int kThumbnailSize = 150;
+
+    explicit ThumbnailCache(QObject *parent = nullptr);
+    ~ThumbnailCache() override;
+
+    // The thumbnail for key, or a placeholder when it is not loaded (yet).
+    QPixmap thumbnail(int key) const;
+    bool isResolved(int key) const;
+
+    // cacheKey identifies the artwork on disk (stable across sessions);
+    // sourcePath is a track whose folder or tags provide the cover.
+    void request(int key, const QString &cacheKey, const QString &sourcePath, int priority);
+    // Cancels every queued request whose key is not in keys.
+    void retainOnly(const QSet<int> &keys);
+
+    qint64 memoryBytes() const { return qint64(pixmaps_.totalCost()) * 1024; }
+    // Drops least recently used thumbnails until at most bytes are held.
+    void trimTo(qint64 bytes);
+    QString report() const;
+
+signals:
+    void thumbnailReady(int key);
+
+private:
+    class Task;
+
+    void finish(Task *task, const QImage &image);
+    // Trims the disk cache on the pool, at startup and every few hundred writes.
+    void trimDisk();
+
+    QThreadPool pool_;
+    QHash<int, Task *> pending_;
+    QCache<int, QPixmap> pixmaps_;
+    QSet<int> missing_;
+    QPixmap placeholder_;
+    QString directory_;
+    int decoded_ = 0;
+    int cancelled_ = 0;
+    int rendered_ = 0;
+};
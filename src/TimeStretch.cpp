@@ -0,0 +1,133 @@
+#include "TimeStretch.h"
+#include "PcmBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+// 40 ms windows at 50 % overlap, shifted by at most 10 ms.
+constexpr int kWindowsPerSecond = 25;
+constexpr int kCoarseStride = 2;
+
+float dot(const float *a, const float *b, int count, int stride) {
+    // Contiguous when stride is 1, which the compiler vectorises.
+    float sum = 0.0f;
+    for (int i = 0; i < count; i += stride) sum += a[i] * b[i];
+    return sum;
+}
+} // namespace
+
+void TimeStretch::configure(int sampleRate, int channels) {
+    channels_ = channels;
+    hop_ = std::max(64, sampleRate / kWindowsPerSecond / 2);
+    frameSize_ = hop_ * 2;
+    searchRadius_ = hop_ / 2;
+    // Periodic Hann windows at half-window hops sum to one.
+    window_.resize(size_t(frameSize_));
+    for (int i = 0; i < frameSize_; ++i) window_[size_t(i)] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / frameSize_));
+    accumulator_.assign(size_t(frameSize_) * channels, 0.0f);
+    segment_.resize(size_t(2 * searchRadius_ + frameSize_) * channels);
+    reference_.resize(size_t(hop_));
+    search_.resize(size_t(2 * searchRadius_ + hop_));
+    ready_.resize(size_t(hop_) * channels);
+    reset(0);
+}
+
+void TimeStretch::reset(qint64 frame) {
+    std::fill(accumulator_.begin(), accumulator_.end(), 0.0f);
+    readyOffset_ = 0;
+    readyFrames_ = 0;
+    analysisPos_ = double(frame);
+    previousStart_ = -1;
+}
+
+void TimeStretch::jump(qint64 frame) {
+    analysisPos_ = double(frame);
+    previousStart_ = -1;
+}
+
+qint64 TimeStretch::process(const PcmBuffer &pcm, double rate, qint16 *out, qint64 frames, qint64 stopAt) {
+    rate = std::clamp(rate, kMinRate, kMaxRate);
+    qint64 written = 0;
+    while (written < frames) {
+        if (readyFrames_ == 0 && !step(pcm, rate, stopAt)) break;
+        const qint64 count = std::min<qint64>(frames - written, readyFrames_);
+        std::memcpy(out + written * channels_, ready_.data() + qint64(readyOffset_) * channels_,
+                    size_t(count * channels_) * sizeof(qint16));
+        readyOffset_ += int(count);
+        readyFrames_ -= int(count);
+        written += count;
+    }
+    return written;
+}
+
+bool TimeStretch::step(const PcmBuffer &pcm, double rate, qint64 stopAt) {
+    const qint64 available = pcm.availableFrames();
+    const qint64 nominal = position();
+    if (nominal >= available || nominal >= stopAt) return false;
+    if (!pcm.isComplete() && nominal + searchRadius_ + frameSize_ > available) return false;
+
+    qint64 start = nominal;
+    if (previousStart_ >= 0) {
+        // Continue the waveform the previous segment would have played next.
+        readMono(pcm, previousStart_ + hop_, hop_, reference_.data());
+        const qint64 base = std::max<qint64>(0, nominal - searchRadius_);
+        const int candidates = int(std::min<qint64>(nominal + searchRadius_, available) - base) + 1;
+        readMono(pcm, base, candidates - 1 + hop_, search_.data());
+        start = base + bestOffset(candidates);
+    }
+
+    const qint64 got = pcm.read(start, segment_.data(), frameSize_);
+    std::fill(segment_.begin() + got * channels_, segment_.begin() + qint64(frameSize_) * channels_, qint16(0));
+    for (int i = 0; i < frameSize_; ++i) {
+        const float weight = window_[size_t(i)];
+        for (int c = 0; c < channels_; ++c) accumulator_[size_t(i * channels_ + c)] += weight * segment_[size_t(i * channels_ + c)];
+    }
+    const int hopSamples = hop_ * channels_;
+    for (int i = 0; i < hopSamples; ++i) {
+        ready_[size_t(i)] = qint16(std::clamp(std::lround(accumulator_[size_t(i)]), -32768L, 32767L));
+    }
+    std::memmove(accumulator_.data(), accumulator_.data() + hopSamples, size_t(frameSize_ * channels_ - hopSamples) * sizeof(float));
+    std::fill(accumulator_.end() - hopSamples, accumulator_.end(), 0.0f);
+    readyOffset_ = 0;
+    readyFrames_ = hop_;
+    previousStart_ = start;
+    analysisPos_ += hop_ * rate;
+    return true;
+}
+
+void TimeStretch::readMono(const PcmBuffer &pcm, qint64 frame, int frames, float *out) {
+    const qint64 got = pcm.read(frame, segment_.data(), frames);
+    const float scale = 1.0f / channels_;
+    for (qint64 i = 0; i < got; ++i) {
+        float sum = 0.0f;
+        for (int c = 0; c < channels_; ++c) sum += segment_[size_t(i * channels_ + c)];
+        out[i] = sum * scale;
+    }
+    std::fill(out + got, out + frames, 0.0f);
+}
+
+int TimeStretch::bestOffset(int candidates) const {
+    // Normalised cross-correlation: a coarse pass over every other offset and
+    // sample, then a full-resolution pass around its winner.
+    const auto score = [this](int offset, int stride) {
+        const float *candidate = search_.data() + offset;
+        const float energy = dot(candidate, candidate, hop_, stride);
+        return energy > 0.0f ? dot(reference_.data(), candidate, hop_, stride) / std::sqrt(energy) : 0.0f;
+    };
+    int best = 0;
+    float bestScore = -1e30f;
+    for (int offset = 0; offset < candidates; offset += kCoarseStride) {
+        const float value = score(offset, kCoarseStride);
+        if (value > bestScore) { bestScore = value; best = offset; }
+    }
+    const int coarse = best;
+    bestScore = -1e30f;
+    for (int offset = std::max(0, coarse - kCoarseStride + 1); offset < std::min(candidates, coarse + kCoarseStride); ++offset) {
+        const float value = score(offset, 1);
+        if (value > bestScore) { bestScore = value; best = offset; }
+    }
+    return best;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+class PcmBuffer;
+
+// WSOLA time stretching: plays a PcmBuffer at kMinRate-kMaxRate speed without
+// changing pitch. Windowed segments are taken from the input at the analysis
+// hop (synthesis hop x rate), each shifted within a small search range to the
+// offset that best continues the previous segment, and overlap-added at the
+// synthesis hop.
+//
+// Meant for the render callback: every buffer is sized by configure(), so
+// process() never allocates, and each hop costs the same fixed search.
+class TimeStretch final {
+public:
+    static constexpr double kMinRate = 0.5;
+    static constexpr double kMaxRate = 2.0;
+
+    // Must not run concurrently with process().
+    void configure(int sampleRate, int channels);
+    bool isConfigured() const { return channels_ > 0; }
+
+    // Restarts the analysis at input frame (after a seek or a rate change
+    // from 1x); the first hop fades in.
+    void reset(qint64 frame);
+    // Moves the analysis to frame without clearing the output still being
+    // overlapped, so the old and new material crossfade (loop points).
+    void jump(qint64 frame);
+    // Writes up to frames interleaved output frames and returns how many were
+    // written; stops short while the input is not decoded yet, at its end or
+    // once position() reaches stopAt.
+    qint64 process(const PcmBuffer &pcm, double rate, qint16 *out, qint64 frames,
+                   qint64 stopAt = std::numeric_limits<qint64>::max());
+    // Input frame the next analysis segment starts from.
+    qint64 position() const { return qint64(std::llround(analysisPos_)); }
+
+private:
+    bool step(const PcmBuffer &pcm, double rate, qint64 stopAt);
+    // Reads frames from pcm as a mono mixdown; frames not decoded are zero.
+    void readMono(const PcmBuffer &pcm, qint64 frame, int frames, float *out);
+    int bestOffset(int candidates) const;
+
+    int channels_ = 0;
+    int frameSize_ = 0;
+    int hop_ = 0;
+    int searchRadius_ = 0;
+    std::vector<float> window_;
+    std::vector<float> accumulator_; // frameSize_ interleaved frames
+    std::vector<qint16> segment_;
+    std::vector<float> reference_; // mono, hop_ frames
+    std::vector<float> search_;    // mono, 2 * searchRadius_ + hop_ frames
+    std::vector<qint16> ready_;    // one hop of finished output
+    int readyOffset_ = 0;
+    int readyFrames_ = 0;
+    double analysisPos_ = 0;
+    qint64 previousStart_ = -1;
+};
@@ -0,0 +1,285 @@
+#include "Transcoder.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QThread>
+#include <QUrl>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+#define MUSICPLAYER_HAS_AUDIO_BUFFER_INPUT
+#include <QAudioBuffer>
+#include <QAudioBufferInput>
+#include <QAudioDecoder>
+#include <QAudioFormat>
+#include <QMediaCaptureSession>
+#include <QMediaFormat>
+#include <QMediaRecorder>
+#endif
+
+namespace {
+constexpr qint64 kMaxCacheBytes = qint64(2) * 1024 * 1024 * 1024;
+constexpr int kSampleRate = 48000; // Opus only takes 48 kHz; MP3 is fine with it
+
+struct ProfileSpec {
+    const char *name;
+    const char *suffix;
+    int bitRate;
+};
+
+const ProfileSpec &specOf(Transcoder::Profile profile) {
+    static const ProfileSpec kSpecs[] = {
+        {"mp3", "mp3", 192000},
+        {"opus", "opus", 128000},
+    };
+    return kSpecs[int(profile)];
+}
+
+#ifdef MUSICPLAYER_HAS_AUDIO_BUFFER_INPUT
+QMediaFormat mediaFormatOf(Transcoder::Profile profile) {
+    QMediaFormat format(profile == Transcoder::Profile::Mp3 ? QMediaFormat::MP3 : QMediaFormat::Ogg);
+    format.setAudioCodec(profile == Transcoder::Profile::Mp3 ? QMediaFormat::AudioCodec::MP3 : QMediaFormat::AudioCodec::Opus);
+    return format;
+}
+
+QAudioFormat pcmFormat() {
+    QAudioFormat format;
+    format.setSampleRate(kSampleRate);
+    format.setChannelCount(2);
+    format.setSampleFormat(QAudioFormat::Int16);
+    return format;
+}
+#endif
+} // namespace
+
+#ifdef MUSICPLAYER_HAS_AUDIO_BUFFER_INPUT
+// One source file on its way through decoder, queue and encoder. Jobs live
+// on the transcoder's worker thread and report back to the owner's.
+class Transcoder::Job final : public QObject {
+public:
+    Job(Transcoder *owner, const Request &request, const QString &partPath, QObject *parent)
+        : QObject(parent), owner_(owner), request_(request), input_(pcmFormat()) {
+        decoder_.setAudioFormat(pcmFormat());
+        decoder_.setSource(QUrl::fromLocalFile(request_.sourcePath));
+        recorder_.setMediaFormat(mediaFormatOf(request_.profile));
+        recorder_.setAudioBitRate(specOf(request_.profile).bitRate);
+        recorder_.setAudioSampleRate(kSampleRate);
+        recorder_.setOutputLocation(QUrl::fromLocalFile(partPath));
+        session_.setAudioBufferInput(&input_);
+        session_.setRecorder(&recorder_);
+
+        connect(&decoder_, &QAudioDecoder::bufferReady, this, [this]() { pump(); });
+        connect(&decoder_, &QAudioDecoder::finished, this, [this]() {
+            decoded_ = true;
+            pump();
+        });
+        connect(&decoder_, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), this, [this]() { fail(decoder_.errorString()); });
+        connect(&input_, &QAudioBufferInput::readyToSendAudioBuffer, this, [this]() { pump(); });
+        connect(&recorder_, &QMediaRecorder::errorOccurred, this, [this](QMediaRecorder::Error, const QString &message) { fail(message); });
+        connect(&recorder_, &QMediaRecorder::recorderStateChanged, this, [this](QMediaRecorder::RecorderState state) {
+            if (state != QMediaRecorder::StoppedState || !stopping_ || done_) return;
+            done_ = true;
+            report(true);
+        });
+    }
+
+    void start() {
+        recorder_.record();
+        decoder_.start();
+    }
+
+private:
+    void pump() {
+        if (done_ || stopping_) return;
+        // Alternate between handing buffers to the encoder and refilling the
+        // queue until neither side moves.
+        for (bool moved = true; moved;) {
+            moved = false;
+            while (!queue_.isEmpty() && input_.sendAudioBuffer(queue_.head())) {
+                queue_.dequeue();
+                moved = true;
+            }
+            while (queue_.size() < kMaxQueuedBuffers && decoder_.bufferAvailable()) {
+                const QAudioBuffer buffer = decoder_.read();
+                if (buffer.isValid()) queue_.enqueue(buffer);
+                moved = true;
+            }
+        }
+        // Left-over decoder output waits for readyToSendAudioBuffer().
+        const bool full = queue_.size() >= kMaxQueuedBuffers;
+        if (full && !stalled_) owner_->stalls_.fetch_add(1, std::memory_order_relaxed);
+        stalled_ = full;
+        if (decoded_ && queue_.isEmpty() && !decoder_.bufferAvailable()) {
+            stopping_ = true;
+            recorder_.stop();
+        }
+    }
+
+    void fail(const QString &message) {
+        if (done_) return;
+        done_ = true;
+        qWarning("Transcoder: %s: %s", qPrintable(request_.sourcePath), qPrintable(message));
+        decoder_.stop();
+        recorder_.stop();
+        report(false);
+    }
+
+    void report(bool ok) {
+        const QString key = Transcoder::key(request_.sourceHash, request_.profile);
+        const QString produced = recorder_.actualLocation().toLocalFile();
+        Transcoder *owner = owner_;
+        QMetaObject::invokeMethod(owner, [owner, key, produced, ok]() { owner->jobDone(key, produced, ok); }, Qt::QueuedConnection);
+        // Signals of the job may still be on the stack.
+        deleteLater();
+    }
+
+    Transcoder *owner_;
+    Request request_;
+    QAudioDecoder decoder_;
+    QAudioBufferInput input_;
+    QMediaRecorder recorder_;
+    QMediaCaptureSession session_; // last: it refers to the two above
+    QQueue<QAudioBuffer> queue_;
+    bool decoded_ = false;
+    bool stopping_ = false;
+    bool stalled_ = false;
+    bool done_ = false;
+};
+#else
+// Without QAudioBufferInput there is no way to feed an encoder; isAvailable()
+// keeps requests from ever creating one of these.
+class Transcoder::Job final : public QObject {
+public:
+    Job(Transcoder *, const Request &, const QString &, QObject *parent)
+        : QObject(parent) {}
+    void start() {}
+};
+#endif
+
+Transcoder::Transcoder(QObject *parent)
+    : QObject(parent), jobs_(new QObject) {
+    directory_ = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/transcoded";
+    QDir().mkpath(directory_);
+    // Jobs are children of jobs_, which goes with the thread.
+    jobs_->moveToThread(&worker_);
+    connect(&worker_, &QThread::finished, jobs_, &QObject::deleteLater);
+    worker_.setObjectName("Transcoder");
+    worker_.start();
+}
+
+Transcoder::~Transcoder() {
+    worker_.quit();
+    worker_.wait();
+    // Unfinished outputs are useless; drop them with their jobs.
+    for (const QString &part : std::as_const(running_)) QFile::remove(part);
+}
+
+bool Transcoder::parseProfile(const QString &name, Profile *profile) {
+    for (Profile candidate : {Profile::Mp3, Profile::Opus}) {
+        if (name.compare(QLatin1String(specOf(candidate).name), Qt::CaseInsensitive) == 0) {
+            *profile = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Transcoder::isAvailable(Profile profile) {
+#ifdef MUSICPLAYER_HAS_AUDIO_BUFFER_INPUT
+    const QMediaFormat format = mediaFormatOf(profile);
+    return format.isSupported(QMediaFormat::Encode);
+#else
+    Q_UNUSED(profile);
+    return false;
+#endif
+}
+
+bool Transcoder::matches(const QString &suffix, Profile profile) {
+    return suffix.compare(QLatin1String(specOf(profile).suffix), Qt::CaseInsensitive) == 0;
+}
+
+QString Transcoder::key(quint64 sourceHash, Profile profile) {
+    return QString("%1-%2").arg(sourceHash, 16, 16, QLatin1Char('0')).arg(QLatin1String(specOf(profile).name));
+}
+
+QString Transcoder::outputPath(quint64 sourceHash, Profile profile) const {
+    return directory_ + '/' + key(sourceHash, profile) + '.' + QLatin1String(specOf(profile).suffix);
+}
+
+QString Transcoder::cachedOutput(quint64 sourceHash, Profile profile) const {
+    const QString path = outputPath(sourceHash, profile);
+    return QFileInfo(path).size() > 0 ? path : QString();
+}
+
+QString Transcoder::partialOutput(const QString &key) const { return running_.value(key); }
+
+void Transcoder::request(const QString &sourcePath, quint64 sourceHash, Profile profile) {
+    const QString jobKey = key(sourceHash, profile);
+    if (running_.contains(jobKey) || queued_.contains(jobKey)) return;
+    const QString cached = cachedOutput(sourceHash, profile);
+    if (!cached.isEmpty() || sourceHash == 0 || !isAvailable(profile)) {
+        // Answer from the event loop like a real job, after the caller connected.
+        QMetaObject::invokeMethod(this, [this, jobKey, cached]() { emit finished(jobKey, cached); }, Qt::QueuedConnection);
+        return;
+    }
+    queue_.enqueue({sourcePath, sourceHash, profile});
+    queued_.insert(jobKey);
+    startQueued();
+}
+
+QString Transcoder::report() const {
+    QStringList lines;
+    lines << "[Transcoder]";
+    QStringList profiles;
+    for (Profile profile : {Profile::Mp3, Profile::Opus}) {
+        if (isAvailable(profile)) profiles << QLatin1String(specOf(profile).name);
+    }
+    lines << QString("Profiles: %1").arg(profiles.isEmpty() ? QString("none") : profiles.join(", "));
+    lines << QString("Jobs: %1 running, %2 queued, %3 done, %4 failed")
+                 .arg(running_.size()).arg(queue_.size()).arg(completed_).arg(failed_);
+    lines << QString("Encoder back-pressure stalls: %1").arg(stalls_.load(std::memory_order_relaxed));
+    return lines.join('\n');
+}
+
+void Transcoder::startQueued() {
+    while (running_.size() < kMaxJobs && !queue_.isEmpty()) {
+        const Request next = queue_.dequeue();
+        const QString jobKey = key(next.sourceHash, next.profile);
+        queued_.remove(jobKey);
+        const QString partPath = directory_ + '/' + jobKey + ".part." + QLatin1String(specOf(next.profile).suffix);
+        running_.insert(jobKey, partPath);
+        QObject *jobs = jobs_;
+        QMetaObject::invokeMethod(jobs_, [this, jobs, next, partPath]() { (new Job(this, next, partPath, jobs))->start(); });
+    }
+}
+
+void Transcoder::jobDone(const QString &jobKey, const QString &produced, bool ok) {
+    const auto it = running_.constFind(jobKey);
+    if (it == running_.cend()) return;
+    const QString output = ok && !produced.isEmpty() ? directory_ + '/' + jobKey + '.' + QFileInfo(it.value()).suffix() : QString();
+    running_.erase(it);
+    if (!output.isEmpty()) QFile::remove(output);
+    const bool renamed = !output.isEmpty() && QFile::rename(produced, output);
+    if (!renamed) {
+        if (!produced.isEmpty()) QFile::remove(produced);
+        ++failed_;
+    } else {
+        ++completed_;
+    }
+    emit finished(jobKey, renamed ? output : QString());
+    trimCache();
+    startQueued();
+}
+
+void Transcoder::trimCache() {
+    // Newest first; whatever falls beyond the budget goes, oldest first.
+    const QFileInfoList files = QDir(directory_).entryInfoList(QDir::Files, QDir::Time);
+    qint64 total = 0;
+    for (const QFileInfo &file : files) {
+        if (file.fileName().contains(".part.")) continue;
+        total += file.size();
+        if (total > kMaxCacheBytes) QFile::remove(file.absoluteFilePath());
+    }
+}
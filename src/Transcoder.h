@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QString>
+#include <QThread>
+
+#include <atomic>
+
+// Converts library files for streaming clients that cannot take the original
+// (typically FLAC) and keeps the results on disk.
+//
+// Each job is a three-stage pipeline: QAudioDecoder decodes and resamples to
+// 48 kHz stereo, a queue of at most kMaxQueuedBuffers buffers hands the audio
+// over, and QMediaRecorder encodes it through a QAudioBufferInput. All three
+// run on the transcoder's worker thread, off the owner's event loop. The
+// queue is the backpressure point: it stops pulling from the decoder while
+// the encoder refuses buffers. At most kMaxJobs jobs run at once; outputs are
+// written to a .part file that grows as the job goes (see partialOutput()),
+// then cached by source content hash and profile. Encoding needs Qt 6.8
+// (QAudioBufferInput); older builds report every profile as unavailable and
+// callers serve the original file.
+class Transcoder final : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Profile { Mp3, Opus };
+
+    static constexpr int kMaxJobs = 2;
+    static constexpr int kMaxQueuedBuffers = 16;
+
+    explicit Transcoder(QObject *parent = nullptr);
+    ~Transcoder() override;
+
+    static bool parseProfile(const QString &name, Profile *profile);
+    static bool isAvailable(Profile profile);
+    // Whether a file with this suffix already is what the profile produces.
+    static bool matches(const QString &suffix, Profile profile);
+    static QString key(quint64 sourceHash, Profile profile);
+
+    // The finished output for the source, or an empty string.
+    QString cachedOutput(quint64 sourceHash, Profile profile) const;
+    // The output a running job is still writing, or an empty string. It is
+    // renamed to the cached output just before finished().
+    QString partialOutput(const QString &key) const;
+    // Starts (or joins) a job; finished() reports the result under key().
+    void request(const QString &sourcePath, quint64 sourceHash, Profile profile);
+    QString report() const;
+
+signals:
+    // outputPath is empty when the job failed.
+    void finished(const QString &key, const QString &outputPath);
+
+private:
+    class Job;
+    struct Request {
+        QString sourcePath;
+        quint64 sourceHash = 0;
+        Profile profile = Profile::Mp3;
+    };
+
+    QString outputPath(quint64 sourceHash, Profile profile) const;
+    void startQueued();
+    void jobDone(const QString &key, const QString &producedPath, bool ok);
+    void trimCache();
+
+    QString directory_;
+    QThread worker_;
+    QObject *jobs_; // parent of the jobs, on worker_
+    QHash<QString, QString> running_; // key -> .part output
+    QQueue<Request> queue_;
+    QSet<QString> queued_;
+    int completed_ = 0;
+    int failed_ = 0;
+    std::atomic<int> stalls_{0}; // times the encoder pushed back on a full queue
+};
@@ -1,10 +1,33 @@
 #include "MainWindow.h"
+#include "SingleInstance.h"
+#include "Theme.h"
 
 #include <QApplication>
+#include <QFileInfo>
+#include <QUrl>
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
+
+    QStringList paths;
+    for (const QString &arg : app.arguments().mid(1)) {
+        const QUrl url(arg);
+        if (url.scheme() == "http" || url.scheme() == "https") paths.append(arg);
+        else paths.append(QFileInfo(url.isLocalFile() ? url.toLocalFile() : arg).absoluteFilePath());
+    }
+    // Hand over to a running player before paying for a window and a scan.
+    SingleInstance instance;
+    if (instance.handOver(paths)) return 0;
+
+    Theme::apply(Theme::Kind::Light);
     MainWindow window;
     window.show();
+    QObject::connect(&instance, &SingleInstance::pathsReceived, &window, [&window](const QStringList &paths) {
+        window.setWindowState(window.windowState() & ~Qt::WindowMinimized);
+        window.raise();
+        window.activateWindow();
+        window.openPaths(paths);
+    });
+    window.openPaths(paths);
     return app.exec();
 }
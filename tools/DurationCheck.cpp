@@ -0,0 +1,101 @@
+// Compares the playing time readDurationMs() takes from container headers
+// with a full decode of the same file, over a corpus of sample files.
+//
+//   duration-check [--tolerance ms] PATH...
+//
+// PATH may be a file or a folder, which is walked for audio files. Files whose
+// header duration is off by more than the tolerance are listed and the exit
+// code is their number (capped at 125), so the check can run from a script.
+// Files without one (raw AAC) are listed too but not counted.
+
+#include "LibraryScanner.h"
+#include "TagReader.h"
+
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QUrl>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+// What a decode adds or trims at the ends (encoder delay, padding the
+// headers do not describe) stays well below this.
+constexpr qint64 kDefaultToleranceMs = 50;
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Checks header durations against full decodes.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "Audio files or folders of them.", "PATH...");
+    const QCommandLineOption tolerance("tolerance", "Allowed difference.", "ms", QString::number(kDefaultToleranceMs));
+    parser.addOption(tolerance);
+    parser.process(app);
+    if (parser.positionalArguments().isEmpty()) parser.showHelp(1);
+    const qint64 toleranceMs = std::max<qint64>(0, parser.value(tolerance).toLongLong());
+
+    QStringList files;
+    for (const QString &path : parser.positionalArguments()) {
+        if (QFileInfo(path).isFile()) {
+            files.append(path);
+            continue;
+        }
+        QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString file = it.next();
+            if (isAudioFile(file)) files.append(file);
+        }
+    }
+    files.sort();
+
+    // One decoder, one file after the other, driven by the event loop.
+    QAudioDecoder decoder;
+    int next = 0;
+    int mismatches = 0;
+    qint64 decodedFrames = 0;
+    int sampleRate = 0;
+    qint64 headerMs = 0;
+    const auto start = [&]() {
+        if (next >= files.size()) {
+            qInfo("%lld files, %d mismatches", qint64(files.size()), mismatches);
+            app.exit(std::min(mismatches, 125));
+            return;
+        }
+        const QString file = files[next];
+        headerMs = readDurationMs(file);
+        decodedFrames = 0;
+        sampleRate = 0;
+        decoder.setSource(QUrl::fromLocalFile(file));
+        decoder.start();
+    };
+    const auto report = [&](const QString &error) {
+        const QString file = files[next++];
+        const qint64 decodedMs = sampleRate > 0 ? decodedFrames * 1000 / sampleRate : 0;
+        if (!error.isEmpty()) {
+            qWarning("%s: cannot decode: %s", qPrintable(file), qPrintable(error));
+        } else if (headerMs == 0 && decodedMs > 0) {
+            qInfo("%s: no header duration, decoded %lld ms", qPrintable(file), decodedMs);
+        } else if (headerMs > 0 && std::abs(headerMs - decodedMs) > toleranceMs) {
+            ++mismatches;
+            qWarning("%s: header %lld ms, decoded %lld ms", qPrintable(file), headerMs, decodedMs);
+        }
+        decoder.stop();
+        QMetaObject::invokeMethod(&app, start, Qt::QueuedConnection);
+    };
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &app, [&]() {
+        const QAudioBuffer buffer = decoder.read();
+        decodedFrames += buffer.frameCount();
+        sampleRate = buffer.format().sampleRate();
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &app, [&]() { report(QString()); });
+    QObject::connect(&decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), &app,
+                     [&]() { report(decoder.errorString()); });
+    QMetaObject::invokeMethod(&app, start, Qt::QueuedConnection);
+    return app.exec();
+}
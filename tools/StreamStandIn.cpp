@@ -0,0 +1,234 @@
+// Local stand-in for an Icecast server or a web server hosting a file, for
+// trying StreamBuffer against latency, stalls, dropped connections and error
+// responses without depending on a real station.
+//
+//   stream-standin [options] FILE
+//
+// Play http://127.0.0.1:8000/ in the player (Ctrl+L). As a remote file the
+// server honours Range requests, so resuming after --drop-after can be
+// watched in the diagnostics window; with --live it loops FILE at the given
+// bitrate and, when asked for, interleaves ICY metadata whose title changes
+// on every loop.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHostAddress>
+#include <QRegularExpression>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+constexpr int kTickMs = 100;
+constexpr qint64 kFileChunkBytes = 64 * 1024;
+constexpr qint64 kStallIntervalMs = 10000;
+
+struct Options {
+    bool live = false;
+    int bitrateKbps = 128;
+    qint64 metaInterval = 16000;
+    int latencyMs = 0;
+    int stallMs = 0;
+    qint64 dropAfter = -1;
+    int failCount = 0;
+};
+
+// One client: reads the request, answers after the configured latency and
+// then writes the body from a timer, so stalls and pacing are independent of
+// how fast the client reads.
+class Connection final : public QObject {
+public:
+    Connection(QTcpSocket *socket, const Options &options, const QByteArray &data, int requestNumber)
+        : QObject(socket), socket_(socket), options_(options), data_(data), requestNumber_(requestNumber) {
+        connect(socket_, &QTcpSocket::readyRead, this, [this]() { readRequest(); });
+        connect(socket_, &QTcpSocket::disconnected, socket_, &QObject::deleteLater);
+        tick_.setInterval(kTickMs);
+        connect(&tick_, &QTimer::timeout, this, [this]() { writeBody(); });
+    }
+
+private:
+    void readRequest() {
+        if (answered_) {
+            socket_->readAll();
+            return;
+        }
+        request_ += socket_->readAll();
+        if (!request_.contains("\r\n\r\n")) return;
+        answered_ = true;
+        QTimer::singleShot(options_.latencyMs, this, [this]() { respond(); });
+    }
+
+    void respond() {
+        const QString request = QString::fromLatin1(request_);
+        qInfo("#%d %s", requestNumber_, qPrintable(request.section("\r\n", 0, 0)));
+        if (requestNumber_ <= options_.failCount) {
+            const QByteArray body = "<html><body><h1>503 Service Unavailable</h1></body></html>\n";
+            socket_->write("HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/html\r\nContent-Length: "
+                           + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+            socket_->disconnectFromHost();
+            return;
+        }
+        QByteArray headers;
+        if (options_.live) {
+            icy_ = request.contains(QRegularExpression("^Icy-MetaData:\\s*1", QRegularExpression::MultilineOption
+                                                                                   | QRegularExpression::CaseInsensitiveOption));
+            untilMeta_ = options_.metaInterval;
+            headers = "HTTP/1.0 200 OK\r\nContent-Type: audio/mpeg\r\nicy-name: Stand-in\r\nicy-br: "
+                      + QByteArray::number(options_.bitrateKbps) + "\r\n";
+            if (icy_) headers += "icy-metaint: " + QByteArray::number(options_.metaInterval) + "\r\n";
+        } else {
+            const QRegularExpressionMatch range = QRegularExpression("^Range:\\s*bytes=(\\d+)-", QRegularExpression::MultilineOption
+                                                                                                    | QRegularExpression::CaseInsensitiveOption)
+                                                      .match(request);
+            position_ = range.hasMatch() ? std::min<qint64>(range.captured(1).toLongLong(), data_.size()) : 0;
+            headers = range.hasMatch() ? "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " + QByteArray::number(position_) + '-'
+                                             + QByteArray::number(data_.size() - 1) + '/' + QByteArray::number(data_.size()) + "\r\n"
+                                       : QByteArray("HTTP/1.1 200 OK\r\n");
+            headers += "Content-Type: application/octet-stream\r\nAccept-Ranges: bytes\r\nContent-Length: "
+                       + QByteArray::number(data_.size() - position_) + "\r\nConnection: close\r\n";
+        }
+        socket_->write(headers + "\r\n");
+        sinceStall_.start();
+        tick_.start();
+        writeBody();
+    }
+
+    void writeBody() {
+        if (stalledUntil_ > 0 && sinceStall_.elapsed() < stalledUntil_) return;
+        if (options_.stallMs > 0 && sinceStall_.elapsed() >= kStallIntervalMs) {
+            qInfo("#%d stalling for %d ms", requestNumber_, options_.stallMs);
+            sinceStall_.restart();
+            stalledUntil_ = options_.stallMs;
+            return;
+        }
+        if (stalledUntil_ > 0) {
+            sinceStall_.restart();
+            stalledUntil_ = 0;
+        }
+        if (options_.live) {
+            // Paced at the bitrate: one tick's worth of audio per tick.
+            writeLive(qint64(options_.bitrateKbps) * 1000 / 8 * kTickMs / 1000);
+        } else if (socket_->bytesToWrite() < kFileChunkBytes) {
+            const qint64 count = std::min(kFileChunkBytes, data_.size() - position_);
+            send(data_.mid(position_, count));
+            position_ += count;
+            if (position_ >= data_.size()) {
+                tick_.stop();
+                socket_->disconnectFromHost();
+            }
+        }
+    }
+
+    void writeLive(qint64 bytes) {
+        while (bytes > 0 && tick_.isActive()) {
+            if (position_ >= data_.size()) {
+                position_ = 0;
+                ++loop_;
+            }
+            qint64 count = std::min(bytes, data_.size() - position_);
+            if (icy_) count = std::min(count, untilMeta_);
+            send(data_.mid(position_, count));
+            position_ += count;
+            bytes -= count;
+            if (!icy_) continue;
+            untilMeta_ -= count;
+            if (untilMeta_ > 0) continue;
+            untilMeta_ = options_.metaInterval;
+            // The title only goes out when it changed; an empty block otherwise.
+            QByteArray block;
+            if (loop_ != sentLoop_) {
+                block = "StreamTitle='Stand-in loop " + QByteArray::number(loop_ + 1) + "';";
+                block.append(QByteArray((16 - block.size() % 16) % 16, '\0'));
+                sentLoop_ = loop_;
+            }
+            socket_->write(QByteArray(1, char(block.size() / 16)) + block);
+        }
+    }
+
+    void send(const QByteArray &body) {
+        QByteArray chunk = body;
+        if (options_.dropAfter >= 0 && sent_ + chunk.size() >= options_.dropAfter) {
+            chunk.truncate(int(options_.dropAfter - sent_));
+            socket_->write(chunk);
+            socket_->flush();
+            qInfo("#%d dropping the connection after %lld bytes", requestNumber_, options_.dropAfter);
+            tick_.stop();
+            socket_->abort();
+            return;
+        }
+        sent_ += chunk.size();
+        socket_->write(chunk);
+    }
+
+    QTcpSocket *socket_;
+    const Options &options_;
+    const QByteArray &data_;
+    const int requestNumber_;
+    QTimer tick_;
+    QElapsedTimer sinceStall_;
+    qint64 stalledUntil_ = 0;
+    QByteArray request_;
+    bool answered_ = false;
+    bool icy_ = false;
+    qint64 position_ = 0;
+    qint64 sent_ = 0;
+    qint64 untilMeta_ = 0;
+    int loop_ = 0;
+    int sentLoop_ = -1;
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Serves FILE over HTTP like a radio station or a web server, with injected faults.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("file", "Audio file to serve.");
+    const QCommandLineOption port("port", "Listen on 127.0.0.1:<port>.", "port", "8000");
+    const QCommandLineOption live("live", "Icecast-style live stream: no length, the file looped at --bitrate.");
+    const QCommandLineOption bitrate("bitrate", "Pace of live streams in kbit/s.", "kbps", "128");
+    const QCommandLineOption metaint("metaint", "ICY metadata interval in bytes.", "bytes", "16000");
+    const QCommandLineOption latency("latency", "Delay before each response.", "ms", "0");
+    const QCommandLineOption stall("stall", "Stop sending for <ms> every 10 s.", "ms", "0");
+    const QCommandLineOption dropAfter("drop-after", "Close each connection after <bytes> of body.", "bytes", "-1");
+    const QCommandLineOption fail("fail", "Answer the first <count> requests with 503.", "count", "0");
+    parser.addOptions({port, live, bitrate, metaint, latency, stall, dropAfter, fail});
+    parser.process(app);
+    if (parser.positionalArguments().size() != 1) parser.showHelp(1);
+
+    QFile file(parser.positionalArguments().first());
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical("Cannot read %s", qPrintable(file.fileName()));
+        return 1;
+    }
+    const QByteArray data = file.readAll();
+    if (data.isEmpty()) {
+        qCritical("%s is empty", qPrintable(file.fileName()));
+        return 1;
+    }
+    Options options;
+    options.live = parser.isSet(live);
+    options.bitrateKbps = std::max(8, parser.value(bitrate).toInt());
+    options.metaInterval = std::max<qint64>(1, parser.value(metaint).toLongLong());
+    options.latencyMs = std::max(0, parser.value(latency).toInt());
+    options.stallMs = std::max(0, parser.value(stall).toInt());
+    options.dropAfter = parser.value(dropAfter).toLongLong();
+    options.failCount = std::max(0, parser.value(fail).toInt());
+
+    QTcpServer server;
+    if (!server.listen(QHostAddress::LocalHost, quint16(parser.value(port).toUInt()))) {
+        qCritical("Cannot listen: %s", qPrintable(server.errorString()));
+        return 1;
+    }
+    int requests = 0;
+    QObject::connect(&server, &QTcpServer::newConnection, &server, [&]() {
+        while (QTcpSocket *socket = server.nextPendingConnection()) new Connection(socket, options, data, ++requests);
+    });
+    qInfo("Serving %s on http://127.0.0.1:%d/ (%s)", qPrintable(file.fileName()), server.serverPort(),
+          options.live ? "live" : "remote file");
+    return app.exec();
+}